@@ -1,7 +1,9 @@
 #ifndef ALLOCATOR_TRAITS_HPP
 #define ALLOCATOR_TRAITS_HPP
+#include <cstddef>
 #include <memory>
 #include <type_traits>
+#include <utility>
 
 namespace GraphGenerator
 {
@@ -31,6 +33,31 @@ namespace GraphGenerator
         inline static auto constexpr has_clone_method = true;
     };
 
+    template<typename T, typename = void>
+    struct detect_reserve_method
+    {
+        inline static auto constexpr has_reserve_method = false;
+    };
+
+    template<typename T>
+    struct detect_reserve_method<T, std::void_t<decltype(std::declval<T&>().reserve(std::size_t{}))>>
+    {
+        inline static auto constexpr has_reserve_method = true;
+    };
+
+    // Allocators whose memory can be written out and mapped back with the same handles
+    template<typename T, typename = void>
+    struct detect_used_spans_method
+    {
+        inline static auto constexpr has_used_spans_method = false;
+    };
+
+    template<typename T>
+    struct detect_used_spans_method<T, std::void_t<decltype(std::declval<T const&>().usedSpans())>>
+    {
+        inline static auto constexpr has_used_spans_method = true;
+    };
+
     template<typename Alloc>
     struct AllocatorTraits : std::allocator_traits<Alloc>
     {
@@ -51,6 +78,15 @@ namespace GraphGenerator
             }
         }
 
+        // Hint that about n more elements are going to be allocated, ignored by allocators without reserve()
+        static void reserve(Alloc& alloc, std::size_t n)
+        {
+            if constexpr (detect_reserve_method<Alloc>::has_reserve_method)
+            {
+                alloc.reserve(n);
+            }
+        }
+
         static handle translate(Alloc& alloc, pointer p)
         {
             if constexpr (select_handle_or_pointer<Alloc>::has_handle)
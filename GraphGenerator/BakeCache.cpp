@@ -0,0 +1,86 @@
+#include "BakeCache.hpp"
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+namespace GraphGenerator
+{
+    void BakeHash::update(std::span<std::byte const> bytes) noexcept
+    {
+        for (auto byte : bytes)
+        {
+            hash ^= static_cast<std::uint64_t>(byte);
+            hash *= 0x100000001b3ULL;
+        }
+    }
+
+    void BakeHash::updateWithContent(std::span<std::byte const> content) noexcept
+    {
+        update(static_cast<std::uint64_t>(content.size()));
+        update(content);
+    }
+
+    std::uint64_t BakeHash::value() const noexcept
+    {
+        return hash;
+    }
+
+    BakeCache::BakeCache(std::filesystem::path directory) :
+        directory{ std::move(directory) }
+    {
+        std::filesystem::create_directories(this->directory);
+    }
+
+    std::string BakeCache::toHex(std::uint64_t key)
+    {
+        char hex[17] = {};
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+        return hex;
+    }
+
+    std::filesystem::path BakeCache::entryPath(std::uint64_t key, std::string_view extension) const
+    {
+        return directory / (toHex(key) + std::string(extension));
+    }
+
+    std::optional<std::vector<std::byte>> BakeCache::load(std::uint64_t key, std::string_view extension) const
+    {
+        auto file = std::ifstream(entryPath(key, extension), std::ios::binary | std::ios::ate);
+        if (not file)
+        {
+            return std::nullopt;
+        }
+        std::vector<std::byte> bytes(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0);
+        if (not file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+        {
+            return std::nullopt;
+        }
+        return bytes;
+    }
+
+    void BakeCache::store(std::uint64_t key, std::string_view extension, std::span<std::byte const> bytes) const
+    {
+        auto path = entryPath(key, extension);
+        auto temporary = path;
+        // Unique across threads and processes sharing the cache
+        temporary += ".tmp" + std::to_string(std::random_device{}()) + std::to_string(std::random_device{}());
+        {
+            auto file = std::ofstream(temporary, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            if (not file)
+            {
+                throw std::runtime_error{ "Cannot write " + temporary.string() };
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        if (error)
+        {
+            std::filesystem::remove(temporary, error);
+            throw std::runtime_error{ "Cannot write " + path.string() };
+        }
+    }
+}
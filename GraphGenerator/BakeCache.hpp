@@ -0,0 +1,56 @@
+#ifndef BAKE_CACHE_HPP
+#define BAKE_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace GraphGenerator
+{
+    // Bump whenever a change of the generator changes its outputs, old cache entries are never reused then
+    inline constexpr std::uint32_t bakeGeneratorVersion = 2;
+
+    // 64 bit FNV-1a, used to build cache keys
+    class BakeHash
+    {
+    public:
+        void update(std::span<std::byte const> bytes) noexcept;
+        template<typename T>
+        void update(T const& value) noexcept
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            update(std::as_bytes(std::span{ &value, 1 }));
+        }
+        // Hashes the content of a file with its size, not its name or time stamp
+        void updateWithContent(std::span<std::byte const> content) noexcept;
+        std::uint64_t value() const noexcept;
+
+    private:
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+    };
+
+    // Content addressed store of bake results: "<directory>/<16 hex digit key><extension>".
+    // Entries are written to a temporary file and renamed, so several processes may share a cache directory.
+    class BakeCache
+    {
+    public:
+        explicit BakeCache(std::filesystem::path directory);
+
+        static std::string toHex(std::uint64_t key);
+        std::filesystem::path entryPath(std::uint64_t key, std::string_view extension) const;
+        // Returns nothing if the entry does not exist or cannot be read
+        std::optional<std::vector<std::byte>> load(std::uint64_t key, std::string_view extension) const;
+        void store(std::uint64_t key, std::string_view extension, std::span<std::byte const> bytes) const;
+
+    private:
+        std::filesystem::path directory;
+    };
+}
+
+#endif // !BAKE_CACHE_HPP
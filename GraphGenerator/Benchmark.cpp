@@ -0,0 +1,205 @@
+#include "OffReader.hpp"
+#include "PathGraphInterface.hpp"
+#include "TriangleBoxOverlap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace GraphGenerator;
+
+namespace
+{
+    struct Box
+    {
+        Vector3 center;
+        float size;
+    };
+
+    // Normalized into [0, 1] like the executable does, random small triangles without an OFF file
+    OffMesh makeMesh(int argc, char* argv[], std::mt19937& random)
+    {
+        if (argc > 1)
+        {
+            OffMesh mesh = readOffFile(argv[1]);
+            float scale = std::max(mesh.max.x - mesh.min.x, std::max(mesh.max.y - mesh.min.y, mesh.max.z - mesh.min.z));
+            for (auto& point : mesh.vertices)
+            {
+                point = (point - mesh.min) / scale;
+            }
+            return mesh;
+        }
+        OffMesh mesh;
+        std::uniform_real_distribution<float> position{ 0, 1 };
+        std::uniform_real_distribution<float> offset{ -1.0f / 64, 1.0f / 64 };
+        for (int t = 0; t < 100000; t++)
+        {
+            Vector3 center{ .x = position(random), .y = position(random), .z = position(random) };
+            for (int i = 0; i < 3; i++)
+            {
+                mesh.indices.push_back(static_cast<int>(mesh.vertices.size()));
+                mesh.vertices.push_back(center + Vector3{ .x = offset(random), .y = offset(random), .z = offset(random) });
+            }
+        }
+        return mesh;
+    }
+
+    // The node at layer that contains point, in an octree of size 1, with the arithmetic of the OctreeNode constructor
+    Box nodeAt(Vector3 const& point, int layer)
+    {
+        Box box{ .center = Vector3{ .x = 0, .y = 0, .z = 0 }, .size = 1 };
+        for (int l = 1; l <= layer; l++)
+        {
+            box.size = 1.0f / (1 << l);
+            box.center = box.center + box.size * Vector3{
+                .x = point.x < box.center.x ? -1.0f : 1.0f,
+                .y = point.y < box.center.y ? -1.0f : 1.0f,
+                .z = point.z < box.center.z ? -1.0f : 1.0f };
+        }
+        return box;
+    }
+
+    // Best of a few runs, in milliseconds
+    double measure(std::function<void()> const& function)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (int run = 0; run < 5; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            function();
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    void report(char const* name, double scalar, double kernel, std::size_t tests, std::size_t mismatches)
+    {
+        std::cout << name << ": scalar " << scalar << " ms, " << triangleBoxOverlapKernel() << " " << kernel << " ms, "
+            << scalar / kernel << "x, " << tests << " tests, " << mismatches << " mismatches" << std::endl;
+    }
+}
+
+// Compares the vectorized triangle / box kernels with the scalar test on the triangles of a mesh,
+// then times a whole octree build that uses them.
+// GraphGeneratorBenchmark [<OFF input> [<layer>]]
+int main(int argc, char* argv[])
+{
+    try
+    {
+        std::mt19937 random{ 42 };
+        OffMesh mesh = makeMesh(argc, argv, random);
+        int maxLayer = argc > 2 ? std::stoi(argv[2]) : 8;
+        std::vector<Vector3 const*> points;
+        for (int t = 0; t < mesh.triangleCount(); t++)
+        {
+            points.push_back(&mesh.vertices[mesh.indices[t * 3 + 0]]);
+            points.push_back(&mesh.vertices[mesh.indices[t * 3 + 1]]);
+            points.push_back(&mesh.vertices[mesh.indices[t * 3 + 2]]);
+        }
+        std::cout << mesh.triangleCount() << " triangles" << std::endl;
+
+        // Every triangle against the children of a node that contains one of its vertices, at every layer
+        std::vector<Box> parents;
+        for (int t = 0; t < mesh.triangleCount(); t++)
+        {
+            for (int layer = 0; layer < maxLayer; layer++)
+            {
+                parents.push_back(nodeAt(*points[t * 3 + random() % 3], layer));
+            }
+        }
+        std::vector<unsigned int> scalarMasks(parents.size());
+        std::vector<unsigned int> kernelMasks(parents.size());
+        double scalar = measure([&]
+        {
+            for (std::size_t i = 0; i < parents.size(); i++)
+            {
+                int t = static_cast<int>(i) / maxLayer;
+                float childSize = parents[i].size / 2;
+                unsigned int mask = 0;
+                for (int r = 0; r < 8; r++)
+                {
+                    Vector3 center = parents[i].center + childSize * Vector3{
+                        .x = (r & 4) ? -1.0f : 1.0f, .y = (r & 2) ? -1.0f : 1.0f, .z = (r & 1) ? -1.0f : 1.0f };
+                    mask |= static_cast<unsigned int>(triangleBoxOverlap(center, childSize, *points[t * 3 + 0], *points[t * 3 + 1], *points[t * 3 + 2])) << r;
+                }
+                scalarMasks[i] = mask;
+            }
+        });
+        double kernel = measure([&]
+        {
+            for (std::size_t i = 0; i < parents.size(); i++)
+            {
+                int t = static_cast<int>(i) / maxLayer;
+                kernelMasks[i] = triangleChildrenOverlap(parents[i].center, parents[i].size / 2, 0, *points[t * 3 + 0], *points[t * 3 + 1], *points[t * 3 + 2]);
+            }
+        });
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < parents.size(); i++)
+        {
+            mismatches += scalarMasks[i] != kernelMasks[i];
+        }
+        report("8 children", scalar, kernel, parents.size() * 8, mismatches);
+
+        // All triangles against every node of layer 2
+        std::vector<int> triangles(mesh.triangleCount());
+        for (int t = 0; t < mesh.triangleCount(); t++)
+        {
+            triangles[t] = t;
+        }
+        std::vector<std::vector<int>> scalarLists(64);
+        std::vector<std::vector<int>> kernelLists(64);
+        auto layer2 = [](int node)
+        {
+            return nodeAt(Vector3{ .x = (node >> 4) * 0.5f - 0.75f, .y = ((node >> 2) & 3) * 0.5f - 0.75f, .z = (node & 3) * 0.5f - 0.75f }, 2);
+        };
+        scalar = measure([&]
+        {
+            for (int node = 0; node < 64; node++)
+            {
+                Box box = layer2(node);
+                scalarLists[node].clear();
+                for (int t : triangles)
+                {
+                    if (triangleBoxOverlap(box.center, box.size, *points[t * 3 + 0], *points[t * 3 + 1], *points[t * 3 + 2]))
+                    {
+                        scalarLists[node].push_back(t);
+                    }
+                }
+            }
+        });
+        kernel = measure([&]
+        {
+            for (int node = 0; node < 64; node++)
+            {
+                Box box = layer2(node);
+                kernelLists[node].clear();
+                appendTrianglesOverlappingBox(box.center, box.size, mesh.vertices, mesh.indices, triangles, kernelLists[node]);
+            }
+        });
+        mismatches = 0;
+        for (int node = 0; node < 64; node++)
+        {
+            mismatches += scalarLists[node] != kernelLists[node];
+        }
+        report("Many triangles", scalar, kernel, triangles.size() * 64, mismatches);
+
+        double build = measure([&]
+        {
+            auto graph = std::unique_ptr<IPathGraph, decltype(&destroyPathGraph)>(makePathGraphWithMemoryPool(1, 0, 1), &destroyPathGraph);
+            graph->addTerrainTriangleArrayMesh(mesh.vertices, mesh.indices, maxLayer, false);
+        });
+        std::cout << "Octree build at layer " << maxLayer << ": " << build << " ms" << std::endl;
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
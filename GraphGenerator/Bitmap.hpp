@@ -1,7 +1,8 @@
 #ifndef BITMAP_HPP
 #define BITMAP_HPP
 
-#include <fstream>
+#include <cstdint>
+#include <ostream>
 #include <vector>
 
 #include "Vector3.hpp"
@@ -34,7 +35,7 @@ namespace GraphGenerator
     };
 #pragma pack(pop)
 
-    void writeToFiles(std::vector<std::vector<Vector3>> colorGraph, std::ofstream& stream)
+    void writeToFiles(std::vector<std::vector<Vector3>> colorGraph, std::ostream& stream)
     {
         auto height = colorGraph.size();
         auto width = colorGraph.size();
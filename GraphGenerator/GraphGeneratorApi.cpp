@@ -0,0 +1,436 @@
+#include "GraphGeneratorApi.h"
+#include "OctreeDag.hpp"
+#include "PathGraphInterface.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace GraphGenerator;
+
+struct GGPathGraph
+{
+    IPathGraph* graph;
+};
+
+namespace
+{
+    static_assert(std::is_same_v<std::int32_t, int>, "indices are passed to the octree without a copy");
+
+    thread_local std::string lastError;
+
+    int fail(int status, std::string message)
+    {
+        lastError = std::move(message);
+        return status;
+    }
+
+    // Runs function and turns exceptions into status codes
+    template<typename Function>
+    int guard(Function&& function) noexcept
+    {
+        try
+        {
+            return function();
+        }
+        catch (std::bad_alloc const&)
+        {
+            return fail(GG_ERROR, "Out of memory");
+        }
+        catch (std::exception const& e)
+        {
+            return fail(GG_ERROR, e.what());
+        }
+        catch (...)
+        {
+            return fail(GG_ERROR, "Unknown error");
+        }
+    }
+
+    int checkMesh(float const* vertices, std::int64_t vertexCount, std::int32_t const* indices, std::int64_t triangleCount)
+    {
+        if (vertexCount < 0 or triangleCount < 0 or (vertexCount > 0 and vertices == nullptr) or (triangleCount > 0 and indices == nullptr))
+        {
+            return fail(GG_INVALID_ARGUMENT, "Invalid mesh buffers");
+        }
+        if (vertexCount > std::numeric_limits<int>::max() or triangleCount > std::numeric_limits<int>::max() / 3)
+        {
+            return fail(GG_INVALID_ARGUMENT, "Mesh is too large");
+        }
+        for (std::int64_t i = 0; i < triangleCount * 3; i++)
+        {
+            if (indices[i] < 0 or indices[i] >= vertexCount)
+            {
+                return fail(GG_INVALID_ARGUMENT, "Vertex index out of range! Index id = " + std::to_string(i) + " value = " + std::to_string(indices[i]));
+            }
+        }
+        return GG_OK;
+    }
+
+    std::vector<Vector3> toVector3(float const* vertices, std::int64_t vertexCount)
+    {
+        std::vector<Vector3> result(static_cast<std::size_t>(vertexCount));
+        for (std::size_t i = 0; i < result.size(); i++)
+        {
+            result[i] = Vector3{ .x = vertices[i * 3 + 0], .y = vertices[i * 3 + 1], .z = vertices[i * 3 + 2] };
+        }
+        return result;
+    }
+
+    int checkComponent(GGPathGraph* graph, int index)
+    {
+        if (graph == nullptr)
+        {
+            return fail(GG_INVALID_ARGUMENT, "graph is null");
+        }
+        if (index <= 0 or index > graph->graph->getComponentTotalCount())
+        {
+            return fail(GG_NO_COMPONENT, "Component " + std::to_string(index) + " does not exist");
+        }
+        return GG_OK;
+    }
+
+    void copyComponentGraph(std::pair<std::vector<Vector3>, std::vector<std::pair<int, int>>> const& component, float* vertices, std::int32_t* edges)
+    {
+        for (std::size_t i = 0; i < component.first.size(); i++)
+        {
+            vertices[i * 3 + 0] = component.first[i].x;
+            vertices[i * 3 + 1] = component.first[i].y;
+            vertices[i * 3 + 2] = component.first[i].z;
+        }
+        for (std::size_t i = 0; i < component.second.size(); i++)
+        {
+            edges[i * 2 + 0] = component.second[i].first;
+            edges[i * 2 + 1] = component.second[i].second;
+        }
+    }
+
+    int toGraphBuffer(std::pair<std::vector<Vector3>, std::vector<std::pair<int, int>>> const& component, GGGraphBuffer* result)
+    {
+        // malloc, so that a buffer is never released with a different allocator than the one it came from
+        auto vertices = static_cast<float*>(std::malloc(std::max<std::size_t>(component.first.size() * 3 * sizeof(float), 1)));
+        auto edges = static_cast<std::int32_t*>(std::malloc(std::max<std::size_t>(component.second.size() * 2 * sizeof(std::int32_t), 1)));
+        if (vertices == nullptr or edges == nullptr)
+        {
+            std::free(vertices);
+            std::free(edges);
+            throw std::bad_alloc{};
+        }
+        copyComponentGraph(component, vertices, edges);
+        result->vertices = vertices;
+        result->edges = edges;
+        result->vertexCount = static_cast<std::int64_t>(component.first.size());
+        result->edgeCount = static_cast<std::int64_t>(component.second.size());
+        return GG_OK;
+    }
+}
+
+extern "C"
+{
+    char const* ggGetLastError(void)
+    {
+        return lastError.c_str();
+    }
+
+    int ggCreatePathGraph(float size, float radius, int minLayer, GGPathGraph** graph)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph is null");
+            }
+            auto result = std::make_unique<GGPathGraph>();
+            result->graph = makePathGraphWithMemoryPool(size, radius, minLayer);
+            *graph = result.release();
+            return GG_OK;
+        });
+    }
+
+    int ggCreateCompactPathGraph(float size, float radius, int minLayer, GGPathGraph** graph)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph is null");
+            }
+            auto result = std::make_unique<GGPathGraph>();
+            result->graph = makeCompactPathGraphWithMemoryPool(size, radius, minLayer);
+            *graph = result.release();
+            return GG_OK;
+        });
+    }
+
+    void ggDestroyPathGraph(GGPathGraph* graph)
+    {
+        if (graph != nullptr)
+        {
+            destroyPathGraph(graph->graph);
+            delete graph;
+        }
+    }
+
+    int ggAddTerrainTriangles(GGPathGraph* graph, float const* vertices, std::int64_t vertexCount,
+        std::int32_t const* indices, std::int64_t triangleCount, int maxLayer, int considerRadius)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph is null");
+            }
+            if (auto status = checkMesh(vertices, vertexCount, indices, triangleCount); status != GG_OK)
+            {
+                return status;
+            }
+            auto points = toVector3(vertices, vertexCount);
+            graph->graph->addTerrainTriangleArrayMesh(points, std::span{ indices, static_cast<std::size_t>(triangleCount * 3) },
+                maxLayer, considerRadius != 0);
+            return GG_OK;
+        });
+    }
+
+    int ggSetNodeBudget(GGPathGraph* graph, std::int64_t nodes)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr or nodes < 0)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph is null or nodes is negative");
+            }
+            graph->graph->setNodeBudget(nodes == 0 ? std::numeric_limits<std::size_t>::max() : static_cast<std::size_t>(nodes));
+            return GG_OK;
+        });
+    }
+
+    int ggCollapseToLayer(GGPathGraph* graph, int layer)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph is null");
+            }
+            graph->graph->collapseToLayer(layer);
+            return GG_OK;
+        });
+    }
+
+    int ggSetRefinable(GGPathGraph* graph, int refinable)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph is null");
+            }
+            graph->graph->setRefinable(refinable != 0);
+            return GG_OK;
+        });
+    }
+
+    int ggRefineTo(GGPathGraph* graph, int layer)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph is null");
+            }
+            graph->graph->refineTo(layer);
+            return GG_OK;
+        });
+    }
+
+    int ggCalculateTerrainPathGraph(GGPathGraph* graph)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph is null");
+            }
+            graph->graph->calculateTerrainPathGraph();
+            return GG_OK;
+        });
+    }
+
+    int ggSavePathGraph(GGPathGraph* graph, char const* path)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr or path == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph or path is null");
+            }
+            graph->graph->save(path);
+            return GG_OK;
+        });
+    }
+
+    int ggSaveOctreeDag(GGPathGraph* graph, char const* path)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr or path == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph or path is null");
+            }
+            writeOctreeDag(path, graph->graph->compressToDag());
+            return GG_OK;
+        });
+    }
+
+    int ggLoadPathGraph(char const* path, GGPathGraph** graph)
+    {
+        return guard([&]() -> int
+        {
+            if (path == nullptr or graph == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "path or graph is null");
+            }
+            auto result = std::make_unique<GGPathGraph>();
+            result->graph = loadPathGraph(path);
+            *graph = result.release();
+            return GG_OK;
+        });
+    }
+
+    int ggGetComponentCount(GGPathGraph* graph)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph is null");
+            }
+            return graph->graph->getComponentTotalCount();
+        });
+    }
+
+    int ggGetComponentSize(GGPathGraph* graph, int index)
+    {
+        return guard([&]() -> int
+        {
+            if (auto status = checkComponent(graph, index); status != GG_OK)
+            {
+                return status;
+            }
+            return graph->graph->getComponentSize(index);
+        });
+    }
+
+    int ggGetLargestComponent(GGPathGraph* graph)
+    {
+        return guard([&]() -> int
+        {
+            if (graph == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "graph is null");
+            }
+            return graph->graph->getLargestComponent();
+        });
+    }
+
+    int ggCopyComponentGraph(GGPathGraph* graph, int index, int rotate,
+        float* vertices, std::int64_t vertexCapacity, std::int32_t* edges, std::int64_t edgeCapacity, std::int64_t* vertexCount, std::int64_t* edgeCount)
+    {
+        return guard([&]() -> int
+        {
+            if (auto status = checkComponent(graph, index); status != GG_OK)
+            {
+                return status;
+            }
+            // The sizes come without an export, so asking for them first does not cost a second one
+            auto componentSize = static_cast<std::int64_t>(graph->graph->getComponentSize(index));
+            auto componentEdgeCount = static_cast<std::int64_t>(graph->graph->getComponentEdgeCount(index));
+            if (vertexCount != nullptr)
+            {
+                *vertexCount = componentSize;
+            }
+            if (edgeCount != nullptr)
+            {
+                *edgeCount = componentEdgeCount;
+            }
+            if (vertices == nullptr or edges == nullptr or vertexCapacity < componentSize or edgeCapacity < componentEdgeCount)
+            {
+                return fail(GG_BUFFER_TOO_SMALL, "Buffers are too small");
+            }
+            copyComponentGraph(graph->graph->getComponentGraph(index, rotate != 0), vertices, edges);
+            return GG_OK;
+        });
+    }
+
+    int ggGetComponentGraph(GGPathGraph* graph, int index, int rotate, GGGraphBuffer* result)
+    {
+        return guard([&]() -> int
+        {
+            if (result == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "result is null");
+            }
+            if (auto status = checkComponent(graph, index); status != GG_OK)
+            {
+                return status;
+            }
+            return toGraphBuffer(graph->graph->getComponentGraph(index, rotate != 0), result);
+        });
+    }
+
+    void ggFreeGraphBuffer(GGGraphBuffer* buffer)
+    {
+        if (buffer != nullptr)
+        {
+            std::free(buffer->vertices);
+            std::free(buffer->edges);
+            *buffer = GGGraphBuffer{};
+        }
+    }
+
+    int ggBakeMesh(float const* vertices, std::int64_t vertexCount, std::int32_t const* indices, std::int64_t triangleCount,
+        int layer, int rotate, GGGraphBuffer* result)
+    {
+        return guard([&]() -> int
+        {
+            if (result == nullptr)
+            {
+                return fail(GG_INVALID_ARGUMENT, "result is null");
+            }
+            if (auto status = checkMesh(vertices, vertexCount, indices, triangleCount); status != GG_OK)
+            {
+                return status;
+            }
+            auto points = toVector3(vertices, vertexCount);
+            auto min = Vector3{ .x = std::numeric_limits<float>::max(), .y = std::numeric_limits<float>::max(), .z = std::numeric_limits<float>::max() };
+            auto max = Vector3{ .x = std::numeric_limits<float>::lowest(), .y = std::numeric_limits<float>::lowest(), .z = std::numeric_limits<float>::lowest() };
+            for (auto& point : points)
+            {
+                min = Vector3{ .x = std::min(min.x, point.x), .y = std::min(min.y, point.y), .z = std::min(min.z, point.z) };
+                max = Vector3{ .x = std::max(max.x, point.x), .y = std::max(max.y, point.y), .z = std::max(max.z, point.z) };
+            }
+            auto scale = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+            for (auto& point : points)
+            {
+                point.x = (point.x - min.x) / scale;
+                point.y = (point.y - min.y) / scale;
+                point.z = (point.z - min.z) / scale;
+            }
+
+            auto graph = std::unique_ptr<IPathGraph, decltype(&destroyPathGraph)>(makePathGraphWithMemoryPool(1, 0, 1), &destroyPathGraph);
+            graph->addTerrainTriangleArrayMesh(points, std::span{ indices, static_cast<std::size_t>(triangleCount * 3) }, layer, false);
+            graph->calculateTerrainPathGraph();
+            auto index = graph->getLargestComponent();
+            if (index == 0)
+            {
+                return fail(GG_NO_COMPONENT, "Cannot find valid component");
+            }
+            return toGraphBuffer(graph->getComponentGraph(index, rotate != 0), result);
+        });
+    }
+}
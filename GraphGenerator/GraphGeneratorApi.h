@@ -0,0 +1,91 @@
+#ifndef GRAPH_GENERATOR_API_H
+#define GRAPH_GENERATOR_API_H
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifdef GRAPH_GENERATOR_BUILD_LIBRARY
+#define GRAPH_GENERATOR_API __declspec(dllexport)
+#else
+#define GRAPH_GENERATOR_API __declspec(dllimport)
+#endif // GRAPH_GENERATOR_BUILD_LIBRARY
+#else
+#define GRAPH_GENERATOR_API __attribute__((visibility("default")))
+#endif // _WIN32
+
+/*
+ * C interface of the GraphGeneratorLibrary shared library, meant for ctypes and other FFIs.
+ * Nothing throws across this boundary: every function returns a status code
+ * and ggGetLastError() describes the last failure of the calling thread.
+ * Vertices are float[count][3], triangle indices are int32_t[count][3], edges are int32_t[count][2].
+ */
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+    enum
+    {
+        GG_OK = 0,
+        GG_ERROR = -1,
+        GG_INVALID_ARGUMENT = -2,
+        GG_NO_COMPONENT = -3,
+        GG_BUFFER_TOO_SMALL = -4
+    };
+
+    typedef struct GGPathGraph GGPathGraph;
+
+    /* Arrays allocated by the library, release them with ggFreeGraphBuffer */
+    typedef struct GGGraphBuffer
+    {
+        float* vertices;
+        int32_t* edges;
+        int64_t vertexCount;
+        int64_t edgeCount;
+    } GGGraphBuffer;
+
+    GRAPH_GENERATOR_API char const* ggGetLastError(void);
+
+    /* Same as makePathGraphWithMemoryPool, the result is written to *graph */
+    GRAPH_GENERATOR_API int ggCreatePathGraph(float size, float radius, int minLayer, GGPathGraph** graph);
+    /* Same as makeCompactPathGraphWithMemoryPool, the same results with a smaller octree */
+    GRAPH_GENERATOR_API int ggCreateCompactPathGraph(float size, float radius, int minLayer, GGPathGraph** graph);
+    GRAPH_GENERATOR_API void ggDestroyPathGraph(GGPathGraph* graph);
+    /* Vertices have to be inside the octree, i.e. [-size, size] */
+    GRAPH_GENERATOR_API int ggAddTerrainTriangles(GGPathGraph* graph, float const* vertices, int64_t vertexCount,
+        int32_t const* indices, int64_t triangleCount, int maxLayer, int considerRadius);
+    /* Most octree nodes for the triangles added afterwards, see IPathGraph::setNodeBudget. 0 removes the budget */
+    GRAPH_GENERATOR_API int ggSetNodeBudget(GGPathGraph* graph, int64_t nodes);
+    GRAPH_GENERATOR_API int ggCollapseToLayer(GGPathGraph* graph, int layer);
+    /* Keeps the triangles added afterwards so ggRefineTo can go deeper without adding them again, see IPathGraph::setRefinable */
+    GRAPH_GENERATOR_API int ggSetRefinable(GGPathGraph* graph, int refinable);
+    GRAPH_GENERATOR_API int ggRefineTo(GGPathGraph* graph, int layer);
+    GRAPH_GENERATOR_API int ggCalculateTerrainPathGraph(GGPathGraph* graph);
+    /* Snapshot of the octree and its path graph, after ggCalculateTerrainPathGraph.
+     * ggLoadPathGraph maps it back without rebuilding, only in the build that wrote it. */
+    GRAPH_GENERATOR_API int ggSavePathGraph(GGPathGraph* graph, char const* path);
+    GRAPH_GENERATOR_API int ggLoadPathGraph(char const* path, GGPathGraph** graph);
+    /* The octree as a sparse voxel DAG in the OCTDAG format, see OctreeDag.hpp. Not while runtime meshes are added. */
+    GRAPH_GENERATOR_API int ggSaveOctreeDag(GGPathGraph* graph, char const* path);
+    /* Components are numbered from 1 to ggGetComponentCount */
+    GRAPH_GENERATOR_API int ggGetComponentCount(GGPathGraph* graph);
+    GRAPH_GENERATOR_API int ggGetComponentSize(GGPathGraph* graph, int index);
+    /* The component with the most nodes, first one wins on ties, 0 if there is none */
+    GRAPH_GENERATOR_API int ggGetLargestComponent(GGPathGraph* graph);
+    /* Fills caller provided arrays. vertexCount and edgeCount are always written,
+     * GG_BUFFER_TOO_SMALL is returned if the capacities (in vertices and edges) are not enough. */
+    GRAPH_GENERATOR_API int ggCopyComponentGraph(GGPathGraph* graph, int index, int rotate,
+        float* vertices, int64_t vertexCapacity, int32_t* edges, int64_t edgeCapacity, int64_t* vertexCount, int64_t* edgeCount);
+    /* Same as ggCopyComponentGraph, but the library allocates the arrays */
+    GRAPH_GENERATOR_API int ggGetComponentGraph(GGPathGraph* graph, int index, int rotate, GGGraphBuffer* result);
+    GRAPH_GENERATOR_API void ggFreeGraphBuffer(GGGraphBuffer* buffer);
+
+    /* What the GraphGenerator executable does for one OFF file, on a mesh in memory:
+     * scales the mesh into [0, 1], builds the octree at layer and returns the largest component */
+    GRAPH_GENERATOR_API int ggBakeMesh(float const* vertices, int64_t vertexCount, int32_t const* indices, int64_t triangleCount,
+        int layer, int rotate, GGGraphBuffer* result);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // !GRAPH_GENERATOR_API_H
@@ -1,195 +1,766 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "PathGraphInterface.hpp"
+#include "BakeCache.hpp"
 #include "Bitmap.hpp"
+#include "OctreeDag.hpp"
+#include "OffReader.hpp"
+#include "PathGraphFile.hpp"
+#include "ShardedDataset.hpp"
+#include "ThreadPool.hpp"
+#ifdef _WIN32
+#include "Windows/MappedFile.hpp"
+using GraphGenerator::Windows::MappedFile;
+#else
+#include "Unix/MappedFile.hpp"
+using GraphGenerator::Unix::MappedFile;
+#endif // _WIN32
 
 using namespace GraphGenerator;
 using namespace std::literals::string_literals;
 
-int main(int argc, char** argv)
+struct BakeOptions
 {
-	if (argc < 3)
+	// All layers are baked from a single octree, built at the deepest one and collapsed for the others.
+	// With a node budget every layer is built on its own instead.
+	std::vector<int> layers;
+	bool rotate = false;
+	float radius = 0;
+	int minLayer = 1;
+	// Most octree nodes, 0 for no limit. Beyond it the cells that gain the least free space stop early.
+	std::size_t nodeBudget = 0;
+	// Compact octree nodes, see makeCompactPathGraphWithMemoryPool. The results are the same, so it is not part of the cache key.
+	bool compact = false;
+};
+
+// Empty paths are not written.
+// With several layers every path has to contain "{layer}", which is replaced by the layer.
+struct BakeOutputs
+{
+	std::string path;  // text PATHGRAPH
+	std::string graph;  // binary PATHGRAPH
+	std::string bitmap;
+	std::string dag;  // OCTDAG of the octree at the layer
+	std::vector<std::ostream*> graph_streams;  // binary PATHGRAPH per layer of BakeOptions::layers, e.g. shard records
+};
+
+// Parses "6" or a comma separated list like "5,6,7", duplicates are ignored
+bool parseLayers(std::string const& text, std::vector<int>& layers)
+{
+	auto cell = ""s;
+	auto stream = std::istringstream(text);
+	while (std::getline(stream, cell, ','))
 	{
-		std::cerr << "Insufficient arguments! <OFF input> <layer> [-p <Path output>] [-b <Bitmap output>]" << std::endl;
-		return -1;
+		auto layer = std::atoi(cell.c_str());
+		if (std::find(layers.begin(), layers.end(), layer) == layers.end())
+		{
+			layers.push_back(layer);
+		}
 	}
-	auto create_path = false;
-	auto path_output = ""s;
-	auto create_bitmap = false;
-	auto bitmap_output = ""s;
-	auto rotate = false;
-	for (auto i = 3; i < argc; i++)
+	return not layers.empty();
+}
+
+std::string layerPath(std::string path, int layer)
+{
+	auto const placeholder = "{layer}"s;
+	for (auto i = path.find(placeholder); i != std::string::npos; i = path.find(placeholder, i))
 	{
-		if (std::string(argv[i]) == "-p")
+		path.replace(i, placeholder.size(), std::to_string(layer));
+	}
+	return path;
+}
+
+// Output paths need a placeholder to tell layers apart
+bool validateLayerPaths(BakeOptions const& options, std::initializer_list<std::string> paths)
+{
+	for (auto& path : paths)
+	{
+		if (options.layers.size() > 1 && not path.empty() && path.find("{layer}") == std::string::npos)
 		{
-			if (i + 1 >= argc)
-			{
-				std::cerr << "Insufficient arguments! <OFF input> <layer> [-p <Path output>] [-b <Bitmap output>]" << std::endl;
-				return -1;
-			}
-			else
+			std::cerr << "Output " << path << " needs a {layer} placeholder when baking several layers" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Every input that changes the result of a bake is part of the key, the file as the digest of its content
+std::uint64_t bakeCacheKey(std::uint64_t fileDigest, BakeOptions const& options, int layer)
+{
+	auto hash = BakeHash{};
+	hash.update(bakeGeneratorVersion);
+	hash.update(fileDigest);
+	hash.update(layer);
+	hash.update(options.rotate);
+	hash.update(options.radius);
+	hash.update(options.minLayer);
+	// Keys of bakes without a budget stay as they were
+	if (options.nodeBudget != 0)
+	{
+		hash.update(static_cast<std::uint64_t>(options.nodeBudget));
+	}
+	return hash.value();
+}
+
+std::span<std::byte const> asBytes(std::string_view text)
+{
+	return std::as_bytes(std::span{ text.data(), text.size() });
+}
+
+// All outputs are produced from the binary PATHGRAPH, the bitmap file and the OCTDAG, so cached and fresh bakes write the same files
+void writeBakeOutputs(BakeOutputs const& outputs, std::size_t layerIndex, int layer,
+	std::span<std::byte const> graph, std::span<std::byte const> bitmap, std::span<std::byte const> dag)
+{
+	if (not outputs.path.empty())
+	{
+		auto output = std::ofstream(layerPath(outputs.path, layer));
+		writePathGraphText(output, PathGraphView{ graph });
+	}
+	if (not outputs.graph.empty())
+	{
+		auto output = std::ofstream(layerPath(outputs.graph, layer), std::ios::binary);
+		output.write(reinterpret_cast<char const*>(graph.data()), graph.size());
+	}
+	if (layerIndex < outputs.graph_streams.size() && outputs.graph_streams[layerIndex] != nullptr)
+	{
+		outputs.graph_streams[layerIndex]->write(reinterpret_cast<char const*>(graph.data()), graph.size());
+	}
+	if (not outputs.bitmap.empty())
+	{
+		auto output = std::ofstream(layerPath(outputs.bitmap, layer), std::ios::binary);
+		output.write(reinterpret_cast<char const*>(bitmap.data()), bitmap.size());
+	}
+	if (not outputs.dag.empty())
+	{
+		writeOctreeDag(layerPath(outputs.dag, layer), dag);
+	}
+}
+
+// Bakes a single OFF model at every requested layer. Progress is written to log and errors to error.
+// With a cache, a layer is only baked if no result for the same file content and options exists.
+// With a pool, the octree is built and its components are found in parallel.
+// With an arena, the nodes reuse its memory instead of a fresh reservation.
+int bakeModel(std::string const& input, BakeOptions const& options, BakeOutputs const& outputs, std::ostream& log, std::ostream& error,
+	BakeCache const* cache = nullptr, ThreadPool* pool = nullptr, NodeArena* arena = nullptr)
+{
+	auto create_bitmap = not outputs.bitmap.empty();
+	auto create_dag = not outputs.dag.empty();
+	auto rotate = options.rotate;
+
+	// The file is mapped once, its content is hashed for the cache keys and parsed if a layer is missing
+	auto file = MappedFile{};
+	file.open(input);
+	auto text = std::string_view{ static_cast<char const*>(file.data), file.size };
+	auto file_digest = std::uint64_t{ 0 };
+	if (cache != nullptr)
+	{
+		auto hash = BakeHash{};
+		hash.updateWithContent(asBytes(text));
+		file_digest = hash.value();
+	}
+
+	// Indices into options.layers which are not cached
+	std::vector<std::size_t> missing;
+	std::vector<std::uint64_t> keys(options.layers.size());
+	for (std::size_t i = 0; i < options.layers.size(); i++)
+	{
+		if (cache != nullptr)
+		{
+			keys[i] = bakeCacheKey(file_digest, options, options.layers[i]);
+			auto cached_graph = cache->load(keys[i], ".pathgraph");
+			auto cached_bitmap = create_bitmap ? cache->load(keys[i], ".bmp") : std::optional{ std::vector<std::byte>{} };
+			auto cached_dag = create_dag ? cache->load(keys[i], ".octdag") : std::optional{ std::vector<std::byte>{} };
+			if (cached_graph && cached_bitmap && cached_dag)
 			{
-				create_path = true;
-				path_output = argv[i + 1];
+				try
+				{
+					PathGraphView{ *cached_graph };
+					if (create_dag)
+					{
+						OctreeDagView{ *cached_dag };
+					}
+					log << "Cache hit " << BakeCache::toHex(keys[i]) << " for " << input << std::endl;
+					writeBakeOutputs(outputs, i, options.layers[i], *cached_graph, *cached_bitmap, *cached_dag);
+					continue;
+				}
+				catch (std::runtime_error const&)
+				{
+					log << "Cache entry " << BakeCache::toHex(keys[i]) << " is corrupted, baking again" << std::endl;
+				}
 			}
 		}
-		if (std::string(argv[i]) == "-b")
+		missing.push_back(i);
+	}
+	if (missing.empty())
+	{
+		return 0;
+	}
+	// Deepest layer first, coarser ones are collapsed from it.
+	// Under a node budget the deepest build spends the budget differently, so every layer is built on its own then.
+	std::sort(missing.begin(), missing.end(), [&](auto a, auto b) { return options.layers[a] > options.layers[b]; });
+
+	log << "Parsing " << input << std::endl;
+	auto mesh = parseOff(text);
+	auto& vertexList = mesh.vertices;
+	auto vertexCount = static_cast<int>(vertexList.size());
+	auto scale = std::max(mesh.max.x - mesh.min.x, std::max(mesh.max.y - mesh.min.y, mesh.max.z - mesh.min.z));
+	for (auto i = 0; i < vertexCount; i++)
+	{
+		vertexList[i].x = (vertexList[i].x - mesh.min.x) / scale;
+		vertexList[i].y = (vertexList[i].y - mesh.min.y) / scale;
+		vertexList[i].z = (vertexList[i].z - mesh.min.z) / scale;
+		if (vertexList[i].x < 0)
 		{
-			if (i + 1 >= argc)
+			error << "Vertex position x < 0! Vertex id = " << i << " value = " << vertexList[i].x << std::endl;
+			return -1;
+		}
+		if (vertexList[i].y < 0)
+		{
+			error << "Vertex position y < 0! Vertex id = " << i << " value = " << vertexList[i].y << std::endl;
+			return -1;
+		}
+		if (vertexList[i].z < 0)
+		{
+			error << "Vertex position z < 0! Vertex id = " << i << " value = " << vertexList[i].z << std::endl;
+			return -1;
+		}
+	}
+
+	auto graph = std::unique_ptr<IPathGraph, decltype(&destroyPathGraph)>(nullptr, &destroyPathGraph);
+	auto status = 0;
+	for (auto layerIndex : missing)
+	{
+		auto layer = options.layers[layerIndex];
+		if (graph != nullptr && options.nodeBudget == 0)
+		{
+			graph->collapseToLayer(layer);
+		}
+		else
+		{
+			// The arena holds one graph at a time
+			graph.reset();
+			if (options.compact)
 			{
-				std::cerr << "Insufficient arguments! <OFF input> <layer> [-p <Path output>] [-b <Bitmap output>]" << std::endl;
-				return -1;
+				graph.reset(arena != nullptr ?
+					makeCompactPathGraphWithMemoryPool(1, options.radius, options.minLayer, *arena) :
+					makeCompactPathGraphWithMemoryPool(1, options.radius, options.minLayer));
 			}
 			else
 			{
-				create_bitmap = true;
-				bitmap_output = argv[i + 1];
+				graph.reset(arena != nullptr ?
+					makePathGraphWithMemoryPool(1, options.radius, options.minLayer, *arena) :
+					makePathGraphWithMemoryPool(1, options.radius, options.minLayer));
 			}
+			if (options.nodeBudget != 0)
+			{
+				graph->setNodeBudget(options.nodeBudget);
+			}
+			graph->addTerrainTriangleArrayMesh(mesh.vertices, mesh.indices, layer, false, pool);
+		}
+		if (options.layers.size() > 1)
+		{
+			log << "Layer " << layer << std::endl;
 		}
 
-		if (std::string(argv[i]) == "-r")
+		graph->calculateTerrainPathGraph(pool);
+		auto componentIndex = graph->getComponentTotalCount();
+
+		log << "Total component count = " << componentIndex << std::endl;
+		for (auto i = 1; i <= componentIndex; i++)
+		{
+			log << "Component " << i << " has size " << graph->getComponentSize(i) << std::endl;
+			log << "Vertex = " << graph->getComponentSize(i) << " Edge = " << graph->getComponentEdgeCount(i) << std::endl;
+		}
+		auto maxIndex = graph->getLargestComponent();
+
+		if (maxIndex == 0)
+		{
+			error << "Cannot find valid component" << (options.layers.size() > 1 ? " at layer " + std::to_string(layer) : ""s) << std::endl;
+			status = -1;
+			continue;
+		}
+
+		auto result = graph->getComponentGraph(maxIndex, rotate);
+		auto graph_bytes = std::ostringstream(std::ios::binary);
+		writePathGraphBinary(graph_bytes, result.first, result.second);
+		auto bitmap_bytes = std::ostringstream(std::ios::binary);
+		if (create_bitmap)
 		{
-			rotate = true;
+			writeToFiles(graph->getComponentColorGraph(maxIndex, layer), bitmap_bytes);
 		}
+		auto dag_bytes = create_dag ? graph->compressToDag() : std::vector<std::byte>{};
+
+		if (cache != nullptr)
+		{
+			cache->store(keys[layerIndex], ".pathgraph", asBytes(graph_bytes.view()));
+			if (create_bitmap)
+			{
+				cache->store(keys[layerIndex], ".bmp", asBytes(bitmap_bytes.view()));
+			}
+			if (create_dag)
+			{
+				cache->store(keys[layerIndex], ".octdag", dag_bytes);
+			}
+		}
+		writeBakeOutputs(outputs, layerIndex, layer, asBytes(graph_bytes.view()), asBytes(bitmap_bytes.view()), dag_bytes);
 	}
+	return status;
+}
+
+struct ManifestEntry
+{
+	std::filesystem::path path;  // relative to the input root
+	std::string object_id;
+	std::string label;
+	std::string split;
+};
 
-	std::cout << "Parsing " << argv[1] << std::endl;
-	auto file = std::ifstream(argv[1]);
-	std::string head;
-	file >> head;
-	if (!head.starts_with("OFF"))
+// Reads the models to bake from either a ModelNet metadata CSV (object_id,class,split,object_path)
+// or a plain list with one OFF path per line. Paths are relative to the input root.
+bool readManifest(std::filesystem::path const& manifest, std::vector<ManifestEntry>& models)
+{
+	auto file = std::ifstream(manifest);
+	if (!file)
 	{
-		file.close();
-		std::cerr << "Not an OFF file!" << std::endl;
-		return -1;
+		return false;
 	}
-	auto vertexCount = 0;
-	auto faceCount = 0;
-	auto edgeCount = 0;
-	// Normal case
-	if (head == "OFF")
+	std::string line;
+	// Missing columns are none, which is never below cells.size()
+	auto const none = std::string::npos;
+	auto path_column = none;
+	auto id_column = none;
+	auto label_column = none;
+	auto split_column = none;
+	auto first = true;
+	while (std::getline(file, line))
 	{
-		file >> vertexCount >> faceCount >> edgeCount;
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+		if (line.empty() || line.starts_with("#"))
+		{
+			continue;
+		}
+		std::vector<std::string> cells;
+		auto cell = ""s;
+		auto stream = std::istringstream(line);
+		while (std::getline(stream, cell, ','))
+		{
+			cells.push_back(cell);
+		}
+		if (first)
+		{
+			first = false;
+			for (std::size_t i = 0; i < cells.size(); i++)
+			{
+				path_column = cells[i] == "object_path" ? i : path_column;
+				id_column = cells[i] == "object_id" ? i : id_column;
+				label_column = cells[i] == "class" ? i : label_column;
+				split_column = cells[i] == "split" ? i : split_column;
+			}
+			if (path_column != none)
+			{
+				// CSV header
+				continue;
+			}
+		}
+		auto entry = ManifestEntry{};
+		if (path_column == none)
+		{
+			entry.path = line;
+		}
+		else if (path_column < cells.size())
+		{
+			entry.path = cells[path_column];
+			entry.object_id = id_column < cells.size() ? cells[id_column] : ""s;
+			entry.label = label_column < cells.size() ? cells[label_column] : ""s;
+			entry.split = split_column < cells.size() ? cells[split_column] : ""s;
+		}
+		else
+		{
+			continue;
+		}
+		if (entry.object_id.empty())
+		{
+			entry.object_id = entry.path.stem().string();
+		}
+		models.push_back(std::move(entry));
 	}
-	else
+	return true;
+}
+
+// Bakes every model of a manifest inside this process.
+// Models are scheduled on a work stealing thread pool, because ModelNet40 mesh sizes differ by orders of magnitude.
+// With -s the results are written into a sharded dataset (see ShardedDataset.hpp) instead of one file per model.
+// Node memory is kept in arenas that are reused from model to model, -m trims each one down to that many MiB after a model.
+int runBatch(int argc, char** argv)
+{
+	auto const usage = "Insufficient arguments! --batch <Manifest> <layer>[,<layer>...] <OFF input root> <Path output root> [-j <threads>] [-r] [-f] [-g] [-s <MiB per shard>] [-c <Cache directory>] [-m <MiB kept per arena>] [-n <max octree nodes>] [-l]";
+	if (argc < 6)
 	{
-		vertexCount = std::stoi(head.substr(3));
-		file >> faceCount >> edgeCount;
+		std::cerr << usage << std::endl;
+		return -1;
 	}
-	std::vector<Vector3> vertexList(vertexCount);
-	auto minX = std::numeric_limits<float>::max();
-	auto minY = std::numeric_limits<float>::max();
-	auto minZ = std::numeric_limits<float>::max();
-	auto maxX = std::numeric_limits<float>::min();
-	auto maxY = std::numeric_limits<float>::min();
-	auto maxZ = std::numeric_limits<float>::min();
-	for (auto i = 0; i < vertexCount; i++)
+	auto manifest = std::filesystem::path(argv[2]);
+	auto options = BakeOptions{};
+	if (!parseLayers(argv[3], options.layers))
 	{
-		file >> vertexList[i].x >> vertexList[i].y >> vertexList[i].z;
-		minX = vertexList[i].x < minX ? vertexList[i].x : minX;
-		minY = vertexList[i].y < minY ? vertexList[i].y : minY;
-		minZ = vertexList[i].z < minZ ? vertexList[i].z : minZ;
-		maxX = vertexList[i].x > maxX ? vertexList[i].x : maxX;
-		maxY = vertexList[i].y > maxY ? vertexList[i].y : maxY;
-		maxZ = vertexList[i].z > maxZ ? vertexList[i].z : maxZ;
+		std::cerr << usage << std::endl;
+		return -1;
 	}
-	for (auto i = 0; i < vertexCount; i++)
+	auto input_root = std::filesystem::path(argv[4]);
+	auto output_root = std::filesystem::path(argv[5]);
+	auto threads = std::thread::hardware_concurrency();
+	auto overwrite = false;
+	auto binary = false;
+	auto shard_size = 0ULL;
+	auto arena_keep = std::optional<std::size_t>();
+	auto cache = std::unique_ptr<BakeCache>();
+	for (auto i = 6; i < argc; i++)
 	{
-		auto scale = std::max(maxX - minX, std::max(maxY - minY, maxZ - minZ));
-		vertexList[i].x = (vertexList[i].x - minX) / scale;
-		vertexList[i].y = (vertexList[i].y - minY) / scale;
-		vertexList[i].z = (vertexList[i].z - minZ) / scale;
-		if (vertexList[i].x < 0)
+		if (std::string(argv[i]) == "-j" || std::string(argv[i]) == "-s" || std::string(argv[i]) == "-c" || std::string(argv[i]) == "-m" ||
+			std::string(argv[i]) == "-n")
 		{
-			file.close();
-			std::cerr << "Vertex position x < 0! Vertex id = " << i << " value = " << vertexList[i].x << std::endl;
-			return -1;
+			if (i + 1 >= argc)
+			{
+				std::cerr << usage << std::endl;
+				return -1;
+			}
+			if (std::string(argv[i]) == "-j")
+			{
+				threads = std::max(std::atoi(argv[++i]), 1);
+			}
+			else if (std::string(argv[i]) == "-c")
+			{
+				cache = std::make_unique<BakeCache>(argv[++i]);
+			}
+			else if (std::string(argv[i]) == "-m")
+			{
+				arena_keep = std::max(std::atoll(argv[++i]), 0LL) * 1024 * 1024;
+			}
+			else if (std::string(argv[i]) == "-n")
+			{
+				options.nodeBudget = std::max(std::atoll(argv[++i]), 0LL);
+			}
+			else
+			{
+				shard_size = std::max(std::atoll(argv[++i]), 1LL) * 1024 * 1024;
+			}
 		}
-		if (vertexList[i].y < 0)
+		if (std::string(argv[i]) == "-r")
 		{
-			file.close();
-			std::cerr << "Vertex position y < 0! Vertex id = " << i << " value = " << vertexList[i].y << std::endl;
-			return -1;
+			options.rotate = true;
 		}
-		if (vertexList[i].z < 0)
+		if (std::string(argv[i]) == "-f")
 		{
-			file.close();
-			std::cerr << "Vertex position z < 0! Vertex id = " << i << " value = " << vertexList[i].z << std::endl;
-			return -1;
+			overwrite = true;
+		}
+		if (std::string(argv[i]) == "-l")
+		{
+			options.compact = true;
+		}
+		if (std::string(argv[i]) == "-g")
+		{
+			binary = true;
 		}
 	}
 
-	auto graph = makePathGraphWithMemoryPool(1, 0, 1);
-	auto layer = std::atoi(argv[2]);
-	for (auto i = 0; i < faceCount; i++)
+	if (!validateLayerPaths(options, { output_root.string() }))
 	{
-		auto shape = 0;
-		auto point1 = 0;
-		auto point2 = 0;
-		auto point3 = 0;
-		file >> shape >> point1 >> point2 >> point3;
-		if (shape != 3)
-		{
-			file.close();
-			std::cerr << "Not a triangle! Vertex id = " << i << " value = " << shape << std::endl;
-			return -1;
-		}
-		graph->addTerrainTriangleMesh(vertexList[point1], vertexList[point2], vertexList[point3], layer, false);
+		return -1;
 	}
-	file.close();
 
-	graph->calculateTerrainPathGraph();
-	auto componentIndex = graph->getComponentTotalCount();
+	std::vector<ManifestEntry> models;
+	if (!readManifest(manifest, models))
+	{
+		std::cerr << "Cannot read manifest " << manifest << std::endl;
+		return -1;
+	}
+	std::cout << "Baking " << models.size() << " models on " << threads << " threads" << std::endl;
 
-	std::cout << "Total component count = " << componentIndex << std::endl;
-	auto maxSize = 0;
-	auto maxIndex = 0;
-	for (auto i = 1; i <= componentIndex; i++)
+	// One sharded dataset per layer
+	std::vector<std::unique_ptr<ShardWriter>> shards;
+	if (shard_size != 0)
 	{
-		std::cout << "Component " << i << " has size " << graph->getComponentSize(i) << std::endl;
-		auto component = graph->getComponentGraph(i, rotate);
-		std::cout << "Vertex = " << component.first.size() << " Edge = " << component.second.size() << std::endl;
-		if (component.first.size() > maxSize)
+		for (auto layer : options.layers)
 		{
-			maxSize = component.first.size();
-			maxIndex = i;
+			shards.push_back(std::make_unique<ShardWriter>(layerPath(output_root.string(), layer), shard_size));
 		}
 	}
-	
-	if (maxIndex == 0)
+	// Idle arenas. A thread that waits inside bakeModel only runs tasks of its own model and the main thread only waits,
+	// so a worker bakes one model at a time and at most one arena per worker is in use.
+	std::vector<std::unique_ptr<NodeArena>> arenas;
+	auto live_arenas = std::size_t(0);
+	auto arena_high_water_mark = std::size_t(0);
+	std::mutex arena_mutex;
+	auto take_arena = [&]
 	{
-		std::cerr << "Cannot find valid component" << std::endl;
-		destroyPathGraph(graph);
-		return -1;
+		auto const lock = std::scoped_lock{ arena_mutex };
+		if (arenas.empty())
+		{
+			arenas.push_back(std::make_unique<NodeArena>());
+		}
+		auto arena = std::move(arenas.back());
+		arenas.pop_back();
+		live_arenas++;
+		assert(live_arenas <= threads);
+		return arena;
+	};
+	auto return_arena = [&](std::unique_ptr<NodeArena> arena)
+	{
+		if (arena_keep)
+		{
+			arena->trim(*arena_keep);
+		}
+		auto const lock = std::scoped_lock{ arena_mutex };
+		arena_high_water_mark = std::max(arena_high_water_mark, arena->highWaterMark());
+		arenas.push_back(std::move(arena));
+		live_arenas--;
+	};
+	std::mutex output_mutex;
+	std::atomic<int> finished = 0;
+	std::atomic<int> failed = 0;
+	{
+		auto pool = ThreadPool{ threads };
+		auto group = TaskGroup{ pool };
+		for (std::size_t position = 0; position < models.size(); position++)
+		{
+			group.run([&, position]
+			{
+				auto& model = models[position];
+				auto input = input_root / model.path;
+				auto sharded = not shards.empty();
+				auto output = sharded ? std::filesystem::path(model.object_id) : output_root / model.path;
+				if (!sharded)
+				{
+					output.replace_extension(binary ? ".pathgraph" : ".path");
+				}
+				auto log = std::ostringstream();
+				auto error = std::ostringstream();
+				auto status = 0;
+				// With a cache existing outputs are refreshed instead, they might come from other options
+				auto skipped = !sharded && !cache && !overwrite && std::all_of(options.layers.begin(), options.layers.end(),
+					[&](int layer) { return std::filesystem::exists(layerPath(output.string(), layer)); });
+				if (!skipped)
+				{
+					try
+					{
+						auto outputs = BakeOutputs{};
+						std::vector<std::ostringstream> records(sharded ? options.layers.size() : 0);
+						for (auto& record : records)
+						{
+							outputs.graph_streams.push_back(&record);
+						}
+						if (!sharded)
+						{
+							for (auto layer : options.layers)
+							{
+								std::filesystem::create_directories(std::filesystem::path(layerPath(output.string(), layer)).parent_path());
+							}
+							(binary ? outputs.graph : outputs.path) = output.string();
+						}
+						auto arena = take_arena();
+						try
+						{
+							status = bakeModel(input.string(), options, outputs, log, error, cache.get(), &pool, arena.get());
+						}
+						catch (...)
+						{
+							return_arena(std::move(arena));
+							throw;
+						}
+						return_arena(std::move(arena));
+						for (std::size_t i = 0; i < records.size(); i++)
+						{
+							// Layers without a valid component have no record
+							auto bytes = records[i].view();
+							if (!bytes.empty())
+							{
+								shards[i]->append(position, model.object_id, model.label, model.split, asBytes(bytes));
+							}
+						}
+					}
+					catch (std::exception const& e)
+					{
+						error << e.what() << std::endl;
+						status = -1;
+					}
+				}
+				auto const lock = std::scoped_lock{ output_mutex };
+				auto current = ++finished;
+				if (status != 0)
+				{
+					failed++;
+					std::cerr << "[" << current << "/" << models.size() << "] " << input.string() << " failed: " << error.str();
+				}
+				else
+				{
+					// One path per layer, shard records are named by the object id alone
+					auto written = layerPath(output.string(), options.layers.front());
+					for (std::size_t i = 1; i < options.layers.size() && !sharded; i++)
+					{
+						written += ", " + layerPath(output.string(), options.layers[i]);
+					}
+					std::cout << "[" << current << "/" << models.size() << "] " << written << (skipped ? " already exists" : "") << std::endl;
+				}
+			});
+		}
+		group.wait();
 	}
+	for (auto& shard : shards)
+	{
+		shard->finish();
+	}
+	std::cout << "Finished " << finished << " models, " << failed << " failed" << std::endl;
+	std::cout << "Node arenas: " << arenas.size() << ", high water mark " << arena_high_water_mark / (1024 * 1024) << " MiB" << std::endl;
+	return failed == 0 ? 0 : -1;
+}
 
-	auto result = graph->getComponentGraph(maxIndex, rotate);
-	if (create_path)
+int main(int argc, char** argv)
+{
+	if (argc >= 2 && std::string(argv[1]) == "--batch")
+	{
+		return runBatch(argc, argv);
+	}
+	auto const usage = "Insufficient arguments! <OFF input> <layer>[,<layer>...] [-p <Path output>] [-g <Binary path output>] [-b <Bitmap output>] [-d <Octree DAG output>] [-c <Cache directory>] [-j <threads>] [-n <max octree nodes>] [-l]";
+	if (argc < 3)
+	{
+		std::cerr << usage << std::endl;
+		return -1;
+	}
+	auto outputs = BakeOutputs{};
+	auto options = BakeOptions{};
+	if (!parseLayers(argv[2], options.layers))
+	{
+		std::cerr << usage << std::endl;
+		return -1;
+	}
+	auto cache = std::optional<BakeCache>();
+	auto threads = std::thread::hardware_concurrency();
+	for (auto i = 3; i < argc; i++)
 	{
-		auto output = std::ofstream(path_output);
-		output << "PATHGRAPH" << std::endl;
-		output << result.first.size() << " " << result.second.size() << std::endl;
-		for (auto& position : result.first)
+		if (std::string(argv[i]) == "-p")
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << usage << std::endl;
+				return -1;
+			}
+			else
+			{
+				outputs.path = argv[i + 1];
+			}
+		}
+		if (std::string(argv[i]) == "-b")
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << usage << std::endl;
+				return -1;
+			}
+			else
+			{
+				outputs.bitmap = argv[i + 1];
+			}
+		}
+		if (std::string(argv[i]) == "-g")
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << usage << std::endl;
+				return -1;
+			}
+			else
+			{
+				outputs.graph = argv[i + 1];
+			}
+		}
+		if (std::string(argv[i]) == "-d")
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << usage << std::endl;
+				return -1;
+			}
+			else
+			{
+				outputs.dag = argv[i + 1];
+			}
+		}
+		if (std::string(argv[i]) == "-c")
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << usage << std::endl;
+				return -1;
+			}
+			else
+			{
+				cache.emplace(argv[i + 1]);
+			}
+		}
+		if (std::string(argv[i]) == "-j")
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << usage << std::endl;
+				return -1;
+			}
+			else
+			{
+				threads = std::max(std::atoi(argv[i + 1]), 1);
+			}
+		}
+		if (std::string(argv[i]) == "-n")
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << usage << std::endl;
+				return -1;
+			}
+			else
+			{
+				options.nodeBudget = std::max(std::atoll(argv[i + 1]), 0LL);
+			}
+		}
+
+		if (std::string(argv[i]) == "-r")
 		{
-			output << position.x << " " << position.y << " " << position.z << std::endl;
+			options.rotate = true;
 		}
-		for (auto& link : result.second)
+		if (std::string(argv[i]) == "-l")
 		{
-			output << link.first << " " << link.second << std::endl;
+			options.compact = true;
 		}
-		output.close();
 	}
 
-	if (create_bitmap)
+	if (!validateLayerPaths(options, { outputs.path, outputs.graph, outputs.bitmap, outputs.dag }))
+	{
+		return -1;
+	}
+
+	try
+	{
+		auto pool = ThreadPool{ threads };
+		return bakeModel(argv[1], options, outputs, std::cout, std::cerr, cache ? &*cache : nullptr, &pool);
+	}
+	catch (std::exception const& e)
 	{
-		auto output = std::ofstream(bitmap_output, std::ios::binary);
-		writeToFiles(graph->getComponentColorGraph(maxIndex, layer), output);
-		output.close();
+		std::cerr << e.what() << std::endl;
+		return -1;
 	}
-	
-	destroyPathGraph(graph);
-	return 0;
-}
\ No newline at end of file
+}
@@ -3,12 +3,20 @@
 
 #include "AllocatorTraits.hpp"
 #include "PathGraph.hpp"
+#include "ThreadPool.hpp"
 #include "Vector3.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
-#include <queue>
+#include <set>
+#include <span>
+#include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -22,49 +30,121 @@ namespace GraphGenerator
     template<typename OctreeType>
     class PathGraphNode;
 
-    template<typename Allocator>
+    // Node layouts of Octree
+    // Every wide node keeps its parent link, its center and its path graph data, 48 bytes.
+    struct WideNodes {};
+    // A compact node only keeps its children and its cell, 16 bytes. Parent, neighbors and center are derived
+    // from the cell when they are needed, the path graph data is kept in per node arrays of the octree that are
+    // only allocated once the path graph is calculated. Four times the nodes per cache line while building,
+    // half the memory with the path graph, for a little more work in every query.
+    struct CompactNodes {};
+
+    template<typename Allocator, typename NodeLayout = WideNodes>
     class Octree
     {
     public:
         using PathGraphData = PathGraphDataClass<Octree>;
-        
-        class OctreeNode
+        static bool constexpr hasCompactNodes = std::is_same_v<NodeLayout, CompactNodes>;
+
+        // Triangles of one addTerrainTriangleArrayMesh call
+        struct TriangleBatch
         {
-        public:
-            using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<OctreeNode>;
-            using NodeRef = typename AllocatorTraits<NodeAllocator>::handle;
-            static unsigned int constexpr invalidComponentIndex = 0;
-            static unsigned int constexpr maxComponentIndex = 0xfffff; // 2^20 - 1
+            std::span<Vector3 const> vertices;
+            std::span<int const> indices;
+
+            TriangleBatch(std::span<Vector3 const> vertices, std::span<int const> indices);
+            std::size_t size() const;
+        };
+
+        class OctreeNode;
+        // Triangles kept for the leaves of a refinable octree in compressed sparse rows, row i holds the ones that overlap leaves[i].
+        // A leaf can have several rows, one per addition that reached it.
+        struct LeafTriangles
+        {
+            std::vector<OctreeNode*> leaves;
+            std::vector<std::uint32_t> offsets{ 0 };
+            std::vector<int> triangles;
+
+            void add(OctreeNode* leaf, std::span<int const> leafTriangles);
+        };
+        using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<OctreeNode>;
+        using NodeRef = typename AllocatorTraits<NodeAllocator>::handle;
 
+        struct WideNodeFields
+        {
             NodeRef parent = {};
             NodeRef children = {};
 
-            Vector3 centerPosition;
-
             // At least on MSVC, 
             // bit fields of different types might introduce extra padding,
             // which increases the Octree node size.
-            // So we have to use int instead of bool to avoid padding.
+            // So we have to use std::uint64_t instead of bool to avoid padding.
             // Do not change the order!!! It is carefully designed for padding!
-            // Max layer = 15!
-            unsigned int tree : 16;
-            unsigned int worldIndex0 : 16;
-            unsigned int worldIndex1 : 16;
-            unsigned int worldIndex2 : 16;
-
-            unsigned int layer : 4;
-            unsigned int isContainsMoveableChildren : 1 = false;  // if its children contain meshes
-            unsigned int isMoveable : 1 = false;  // if itself contains a mesh
-            unsigned int isContainsRuntimeMoveableChildren : 1 = false;  // if its children contain runtime meshes
-            unsigned int runtimeMoveableCounter : 5 = 0;
-            unsigned int pathGraphConnectComponentIndex : 20 = invalidComponentIndex;
+            // The cell and the flags fill one 64 bit word, 17 bits per coordinate, so max layer = maxSupportedLayer = 17!
+            // Nodes do not know which octree they belong to,
+            // every operation that needs the octree receives it as a parameter.
+            std::uint64_t worldIndex0 : 17;
+            std::uint64_t worldIndex1 : 17;
+            std::uint64_t worldIndex2 : 17;
 
+            std::uint64_t layer : 5;
+            std::uint64_t isContainsMoveableChildren : 1 = false;  // if its children contain meshes
+            std::uint64_t isMoveable : 1 = false;  // if itself contains a mesh
+            std::uint64_t isContainsRuntimeMoveableChildren : 1 = false;  // if its children contain runtime meshes
+            std::uint64_t runtimeMoveableCounter : 5 = 0;
+
+            Vector3 centerPosition;
+
+            unsigned int pathGraphConnectComponentIndex = 0;
+            // Place of the node in Octree::components of its component, only meaningful for nodes of the path graph
+            unsigned int pathGraphComponentPosition = 0;
+            // Number of the leaf in the last numbering of calculateTerrainPathGraph or updateSCC, the row of the frozen path graph
+            unsigned int pathGraphLeafIndex = 0;
             PathGraphData pathGraphEdges = {};
+        };
+
+        struct CompactNodeFields
+        {
+            NodeRef children = {};
+            // Index of the node in the arrays of Octree::compactNodeData, nodes are numbered as they are constructed
+            unsigned int row = 0;
+
+            // Same as in WideNodeFields
+            std::uint64_t worldIndex0 : 17;
+            std::uint64_t worldIndex1 : 17;
+            std::uint64_t worldIndex2 : 17;
+
+            std::uint64_t layer : 5;
+            std::uint64_t isContainsMoveableChildren : 1 = false;
+            std::uint64_t isMoveable : 1 = false;
+            std::uint64_t isContainsRuntimeMoveableChildren : 1 = false;
+            std::uint64_t runtimeMoveableCounter : 5 = 0;
+        };
+
+        // Fields that only one layout has are read through the accessors of Octree and OctreeNode
+        class OctreeNode : public std::conditional_t<hasCompactNodes, CompactNodeFields, WideNodeFields>
+        {
+        public:
+            using Fields = std::conditional_t<hasCompactNodes, CompactNodeFields, WideNodeFields>;
+            using NodeAllocator = Octree::NodeAllocator;
+            using NodeRef = Octree::NodeRef;
+            static unsigned int constexpr invalidComponentIndex = 0;
 
-            OctreeNode(unsigned int tree, int layer, OctreeNode* parent, int relativeX, int relativeY, int relativeZ);
+            using Fields::children;
+            using Fields::worldIndex0;
+            using Fields::worldIndex1;
+            using Fields::worldIndex2;
+            using Fields::layer;
+            using Fields::isContainsMoveableChildren;
+            using Fields::isMoveable;
+            using Fields::isContainsRuntimeMoveableChildren;
+            using Fields::runtimeMoveableCounter;
+
+            OctreeNode(Octree& octree, int layer, OctreeNode* parent, int relativeX, int relativeY, int relativeZ);
             OctreeNode(OctreeNode&&) = delete;
-            ~OctreeNode();
-            bool instantiateChildren();
+            bool instantiateChildren(Octree& octree);
+            bool instantiateChildren(Octree& octree, NodeAllocator& allocator);
+            void destroyChildren(Octree& octree);
 
             inline static constexpr Vector3 cornerDirections[2][2][2] =
             {
@@ -78,37 +158,95 @@ namespace GraphGenerator
                 }
             };
 
-            float size() const;
-            void leaves(std::vector<OctreeNode*>& result);
-            bool contains(Vector3 const& point);
-            bool intersectWithTriangle(Vector3 point1, Vector3 point2, Vector3 point3, float expansion);
+            float size(Octree const& octree) const;
+            // Compact nodes add up the offsets of their ancestors in the same order as the wide constructor,
+            // so both layouts get the same floats
+            Vector3 center(Octree const& octree) const;
+            void leaves(Octree& octree, std::vector<OctreeNode*>& result);
+            bool contains(Octree const& octree, Vector3 const& point);
+            bool intersectWithTriangle(Octree const& octree, Vector3 point1, Vector3 point2, Vector3 point3, float expansion);
+            static bool intersectWithTriangle(Vector3 const& centerPosition, float size, Vector3 point1, Vector3 point2, Vector3 point3,
+                float expansion);
 
-            void addTerrainTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer,
+            void addTerrainTriangleMesh(Octree& octree, Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer,
                 float expansion, bool wasMoveable = false);
-            void addRuntimeTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer,
+            // New nodes are allocated from allocator, which lets several threads build disjoint subtrees
+            void addTerrainTriangleMesh(Octree& octree, NodeAllocator& allocator, Vector3 const& point1, Vector3 const& point2,
+                Vector3 const& point3, int maxLayer, float expansion, bool wasMoveable = false);
+            // The rest of addTerrainTriangleMesh, once it is known whether the triangle intersects this node.
+            // The children are tested all at once with triangleChildrenOverlap.
+            void insertTerrainTriangle(Octree& octree, NodeAllocator& allocator, Vector3 const& point1, Vector3 const& point2,
+                Vector3 const& point3, int maxLayer, float expansion, bool wasMoveable, bool intersects);
+            // Bulk version of addTerrainTriangleMesh without expansion, every triangle in the list intersects this node.
+            // The list is split among the children in one pass, lists[layer + 1] holds the lists of the children.
+            // With kept the list also stops at nodeBudget, and every leaf it ends at gets a row with its triangles in kept.
+            void addTerrainTriangleList(Octree& octree, NodeAllocator& allocator, TriangleBatch const& batch, std::span<int const> triangles,
+                int maxLayer, std::vector<std::array<std::vector<int>, 8>>& lists, LeafTriangles* kept = nullptr);
+            void addRuntimeTriangleMesh(Octree& octree, Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer,
                 float expansion, int runtimeMeshIndex, std::unordered_set<OctreeNode*>& influencedOctreeNodes, bool wasMoveable = false);
-            void checkContainsRuntimeMoveableChildrenWhenRemove();
-            void removeRuntimeMesh(int runtimeMeshIndex);
+            void insertRuntimeTriangle(Octree& octree, Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer,
+                float expansion, int runtimeMeshIndex, std::unordered_set<OctreeNode*>& influencedOctreeNodes, bool wasMoveable, bool intersects);
+            void checkContainsRuntimeMoveableChildrenWhenRemove(Octree& octree);
+            void removeRuntimeMesh(Octree& octree, int runtimeMeshIndex);
         };
 
-        using NodeRef = typename OctreeNode::NodeRef;
-        using NodeAllocator = typename OctreeNode::NodeAllocator;
         using NodeAllocatorTraits = AllocatorTraits<NodeAllocator>;
         NodeAllocator nodeAllocator;
 
-        unsigned int index;
         float size;
         float radius;
         int minLayer;
 
         OctreeNode* root;
         PathGraph<Octree>* graph;
-        std::size_t numberOfNodes = 0;
-        std::unordered_map<int, std::pair<OctreeNode*, int>> componentMap;  // <index, <node*, size>>
+        std::atomic<std::size_t> numberOfNodes = 0;
+        // Most nodes the octree may have. A cell that would need more stays a leaf, blocked as if it were at maxLayer.
+        std::size_t nodeBudget = std::numeric_limits<std::size_t>::max();
+        // Path graph nodes of component i in components[i - 1], in leaf order after updateSCC.
+        // calculateRuntimePathGraph only relabels the components around the changed nodes, which can leave a component empty
+        // until a later one takes over its number.
+        std::vector<std::vector<OctreeNode*>> components;
+        std::set<unsigned int> emptyComponents;
+        int largestComponent = 0;
+
+        // The path graph of calculateTerrainPathGraph in compressed sparse rows, row i holds the edges of leaves[i].
+        // Read only, anything that changes the octree first moves the edges back into the nodes with thawPathGraph.
+        struct FrozenPathGraph
+        {
+            std::vector<OctreeNode*> leaves;
+            std::vector<std::uint32_t> offsets;
+            std::vector<NodeRef> targets;
+        };
+        FrozenPathGraph frozenPathGraph;
+        bool isPathGraphFrozen = false;
+
+        // Set by setRefinable. The terrain triangles added since then, in one mesh, and the ones that overlap every moveable leaf.
+        bool isRefinable = false;
+        std::vector<Vector3> keptVertices;
+        std::vector<int> keptIndices;
+        LeafTriangles leafTriangles;
 
         std::map<int, std::unordered_set<OctreeNode*>> runtimeMeshIndexToNodes;
         std::unordered_set<OctreeNode*> toRecalculatePathGraph;
 
+        // Path graph data of compact nodes, one entry per CompactNodeFields::row.
+        // A row past the end reads as the defaults of a wide node, writing it grows the arrays up to compactNodeRows,
+        // so rows are only written from several threads after prepareCompactNodeData.
+        struct CompactNodeData
+        {
+            std::vector<unsigned int> componentIndex;
+            std::vector<unsigned int> componentPosition;
+            std::vector<unsigned int> leafIndex;
+            std::vector<PathGraphData> edges;
+        };
+        CompactNodeData compactNodeData;
+        std::atomic<unsigned int> compactNodeRows = 0;
+
+        // Deepest layer the cells of OctreeNode can hold, maxLayer is clamped to it
+        inline static constexpr int maxSupportedLayer = 17;
+        // Layer of the subtrees a parallel build hands out to the threads, 8^3 = 512 subtrees at most
+        inline static constexpr int parallelBuildLayer = 3;
+
         inline static constexpr int adjacentDirections[6][3] =
         {
             { 1, 0, 0 },
@@ -119,41 +257,123 @@ namespace GraphGenerator
             { 0, 0, -1 }
         };
 
-        inline static std::priority_queue<unsigned int> availableIndex;
-        inline static std::vector<Octree*> forest;
-
         Octree(PathGraph<Octree>* graph, float size, float radius, int minLayer, NodeAllocator&& nodeAllocator);
+        // Maps the nodes of a snapshot written by save back into a new arena, the path graph is ready without rebuilding it.
+        // Throws std::runtime_error if the snapshot is invalid or was written by a build with another node layout.
+        Octree(PathGraph<Octree>* graph, std::string const& snapshotPath);
+        // Copies the node memory of other into a new arena and duplicates its tables, in any state of the path graph.
+        // Only for octrees in a memory pool, throws std::logic_error otherwise.
+        Octree(PathGraph<Octree>* graph, Octree& other);
         Octree& operator=(Octree&&) = delete;
         ~Octree();
         void addTerrainTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer, 
             bool considerRadius);
+        // Without radius expansion the triangles are inserted top down as a whole, with a pool the subtrees below
+        // parallelBuildLayer are built in parallel. The result is the same as adding the triangles one by one.
+        // With a nodeBudget the cells are refined by importance instead, see buildTerrainWithBudget.
+        // A refinable octree is built on one thread and stops at nodeBudget like addTerrainTriangleMesh.
+        void addTerrainTriangleArrayMesh(std::span<Vector3 const> vertices, std::span<int const> indices, int maxLayer,
+            bool considerRadius, ThreadPool* pool = nullptr);
         void addRuntimeTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer,
             bool considerRadius, int runtimeMeshIndex);
         void removeRuntimeMesh(int runtimeMeshIndex);
+        // Whether the cell of node can get children without going over nodeBudget
+        bool canRefine(OctreeNode const* node) const;
+        // Generous estimate of the nodes addTerrainTriangleArrayMesh creates, to size the node reservation
+        static std::size_t estimateNodeCount(std::size_t triangleCount, int maxLayer);
+        // Turns the tree into the one addTerrainTriangleMesh would have built with maxLayer = layer,
+        // so coarser layers can be derived without inserting the triangles again. Terrain meshes only.
+        // A refinable octree stays refinable, its collapsed leaves keep the triangles of the leaves below them.
+        void collapseToLayer(int layer);
+        // Keeps every terrain triangle added afterwards together with the moveable leaves it overlaps, so refineTo can go deeper
+        // without inserting the triangles again, for about 4 bytes per triangle and leaf. Only without considerRadius.
+        // Can only be turned on before the first mesh is added, throws std::logic_error otherwise. Snapshots do not keep it.
+        void setRefinable(bool refinable);
+        // Splits the moveable leaves above layer with their kept triangles, into the tree addTerrainTriangleMesh would have built
+        // with maxLayer = layer. A path graph that was calculated gets new edges only around the split leaves, like calculateRuntimePathGraph.
+        // Its components are relabeled around them too, or numbered again by updateSCC when most of the path graph was split.
+        // Only for refinable octrees without runtime meshes, throws std::logic_error otherwise.
+        void refineTo(int layer);
 
         OctreeNode* positionToNode(Vector3 const& position);
         bool lineOfSight(Vector3 const& from, Vector3 const& to);
         // 0 = +x, 1 = -x, 2 = +y, 3 = -y, 4 = +z, 5 = -z
+        // Deepest node at most as deep as node that contains the neighboring cell, found below the common ancestor
         OctreeNode* findAdjacentNode(OctreeNode* node, int directionIndex);
-        void updateSCC();
-        void calculateTerrainPathGraph();
+        // Components are numbered in the order of their first leaf, also when they are found in parallel on the pool
+        void updateSCC(ThreadPool* pool = nullptr);
+        int componentCount() const;
+        // Empty for an index that is not a component
+        std::span<OctreeNode* const> componentView(int index) const;
+        // Relabels the components of the changed nodes, whose edges were just rebuilt.
+        // Costs time in the size of the pieces that split off or merge, not in the size of the octree.
+        void updateComponents(std::vector<OctreeNode*> changed);
+        // Edges are collected in parallel on the pool and frozen, the nodes keep no edge arrays of their own
+        void calculateTerrainPathGraph(ThreadPool* pool = nullptr);
+        // Edges of a node in the path graph, frozen or not
+        std::span<NodeRef const> pathGraphEdgesOf(OctreeNode const* node) const;
+        void thawPathGraph();
         void calculateRuntimePathGraph();
+        // Writes the node memory and the frozen path graph to a snapshot, see OctreeSnapshot.hpp.
+        // Only for octrees in a memory pool after calculateTerrainPathGraph, without runtime meshes, throws std::logic_error otherwise.
+        void save(std::string const& path);
+        // The tree as a sparse voxel DAG in the OCTDAG format, see OctreeDag.hpp. Subtrees are numbered bottom up by the slots
+        // of their children, so identical ones are stored once. Only the moveable leaves are kept, not the path graph.
+        // Terrain meshes only, throws std::logic_error while there are runtime meshes.
+        std::vector<std::byte> compressToDag();
         int samplePosition(Vector3 position, float radius, int scc, Vector3& result);
 
         OctreeNode* allocateNodes(std::size_t count);
+        OctreeNode* allocateNodes(NodeAllocator& allocator, std::size_t count);
         void deallocateNodes(OctreeNode* memory, std::size_t count);
         void constructNode(OctreeNode* memory, int layer, OctreeNode* parent, int relativeX, int relativeY, int relativeZ);
+        void constructNode(NodeAllocator& allocator, OctreeNode* memory, int layer, OctreeNode* parent, int relativeX, int relativeY, int relativeZ);
         void destroyNode(OctreeNode* object);
         NodeRef translate(OctreeNode* object);
         OctreeNode* resolve(NodeRef object);
 
+        // Fields that only wide nodes have, for both layouts
+        OctreeNode* parentOf(OctreeNode* node);
+        unsigned int componentIndexOf(OctreeNode const* node) const;
+        void setComponentIndex(OctreeNode* node, unsigned int index);
+        unsigned int componentPositionOf(OctreeNode const* node) const;
+        void setComponentPosition(OctreeNode* node, unsigned int position);
+        unsigned int leafIndexOf(OctreeNode const* node) const;
+        void setLeafIndex(OctreeNode* node, unsigned int index);
+        // The edges of a node while the path graph is not frozen, pathGraphEdgesOf reads them in any state
+        PathGraphData& pathGraphEdgeArray(OctreeNode* node);
+        // Makes room for every compact node constructed so far, no-op for wide nodes
+        void prepareCompactNodeData();
+
     private:
         static bool intersectRayBox
         (
             Vector3 const& min, Vector3 const& max, Vector3 const& origin,
             float invDirX, float invDirY, float invDirZ, float length
         );
-        OctreeNode* findAdjacentNode(int x, int y, int z, int layer);
+        void buildTerrainSubtree(OctreeNode* node, NodeAllocator& allocator, TriangleBatch const& batch, std::span<int const> candidates,
+            int maxLayer);
+        // Calls body(begin, end) for chunks of [0, count), in parallel if there is a pool
+        template<typename Body>
+        static void forEachChunk(ThreadPool* pool, std::size_t count, Body&& body);
+        // Same as findAdjacentNode, found below start, a node at most as deep as node that contains the neighboring cell
+        OctreeNode* findAdjacentNodeBelow(OctreeNode* node, int directionIndex, OctreeNode* start);
+        // Calls visit(leaf, neighbors) for every leaf, in parallel on subtrees if there is a pool. neighbors are the 6 face
+        // neighbors in the order of adjacentDirections to start findAdjacentNodeBelow from, null at the border of the octree.
+        // They are passed down while walking the tree instead of being kept in every node, a child's neighbor is either
+        // a sibling or the one of its parent.
+        template<typename Visit>
+        void forEachLeafWithNeighbors(ThreadPool* pool, Visit&& visit);
+        unsigned int makeComponent();
+        void attachToComponent(OctreeNode* node, unsigned int index);
+        void detachFromComponent(OctreeNode* node);
+        void updateLargestComponent();
+        bool buildTerrainSubtreesInParallel(TriangleBatch const& batch, int maxLayer, ThreadPool& pool);
+        // Refines the cell that gains the most free children first, so when nodeBudget runs out the cells
+        // that stop early are the ones full of geometry. Same tree as buildTerrainSubtree while the budget lasts.
+        void buildTerrainWithBudget(TriangleBatch const& batch, int maxLayer);
+        // Builds the kept triangles from firstTriangle on into the tree and keeps the triangles of the leaves they end at
+        void addKeptTriangles(std::size_t firstTriangle, int maxLayer);
     };
 }
 
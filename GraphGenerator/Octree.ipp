@@ -1,103 +1,152 @@
 #ifndef _OCTREE_IPP_
 #define _OCTREE_IPP_
 #include "Octree.hpp"
+#include "OctreeDag.hpp"
+#include "OctreeSnapshot.hpp"
+#include "TriangleBoxOverlap.hpp"
 #include "Vector3.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <deque>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <stack>
 
 namespace GraphGenerator
 {
-    template<typename Allocator>
-    Octree<Allocator>::OctreeNode::OctreeNode(unsigned int tree, int layer, OctreeNode* parent, int relativeX, int relativeY, int relativeZ)
+    template<typename Allocator, typename NodeLayout>
+    Octree<Allocator, NodeLayout>::OctreeNode::OctreeNode(Octree& octree, int layer, OctreeNode* parent, int relativeX, int relativeY, int relativeZ)
     {
-        this->tree = tree;
         this->layer = layer;
-        this->parent = Octree::forest[tree]->translate(parent);
+        if constexpr (hasCompactNodes)
+        {
+            this->row = octree.compactNodeRows.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            this->parent = octree.translate(parent);
+        }
         if (parent != nullptr)
         {
             worldIndex0 = (parent->worldIndex0 << 1) + relativeX;
             worldIndex1 = (parent->worldIndex1 << 1) + relativeY;
             worldIndex2 = (parent->worldIndex2 << 1) + relativeZ;
-            centerPosition = parent->centerPosition + size() * cornerDirections[relativeX][relativeY][relativeZ];
+            if constexpr (not hasCompactNodes)
+            {
+                this->centerPosition = parent->centerPosition + size(octree) * cornerDirections[relativeX][relativeY][relativeZ];
+            }
         }
         else
         {
             worldIndex0 = relativeX;
             worldIndex1 = relativeY;
             worldIndex2 = relativeZ;
-            centerPosition = Vector3{ .x = 0, .y = 0, .z = 0 };
+            if constexpr (not hasCompactNodes)
+            {
+                this->centerPosition = Vector3{ .x = 0, .y = 0, .z = 0 };
+            }
         }
     }
 
-    template<typename Allocator>
-    Octree<Allocator>::OctreeNode::~OctreeNode()
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::OctreeNode::destroyChildren(Octree& octree)
     {
-        OctreeNode* memory = Octree::forest[tree]->resolve(children);
+        OctreeNode* memory = octree.resolve(children);
         if (memory != nullptr)
         {
-            Octree::forest[tree]->destroyNode(memory + 0);
-            Octree::forest[tree]->destroyNode(memory + 1);
-            Octree::forest[tree]->destroyNode(memory + 2);
-            Octree::forest[tree]->destroyNode(memory + 3);
-            Octree::forest[tree]->destroyNode(memory + 4);
-            Octree::forest[tree]->destroyNode(memory + 5);
-            Octree::forest[tree]->destroyNode(memory + 6);
-            Octree::forest[tree]->destroyNode(memory + 7);
-            Octree::forest[tree]->deallocateNodes(memory, 8);
+            octree.destroyNode(memory + 0);
+            octree.destroyNode(memory + 1);
+            octree.destroyNode(memory + 2);
+            octree.destroyNode(memory + 3);
+            octree.destroyNode(memory + 4);
+            octree.destroyNode(memory + 5);
+            octree.destroyNode(memory + 6);
+            octree.destroyNode(memory + 7);
+            octree.deallocateNodes(memory, 8);
+            children = NodeRef{};
         }
     }
 
-    template<typename Allocator>
-    bool Octree<Allocator>::OctreeNode::instantiateChildren()
+    template<typename Allocator, typename NodeLayout>
+    bool Octree<Allocator, NodeLayout>::OctreeNode::instantiateChildren(Octree& octree)
+    {
+        return instantiateChildren(octree, octree.nodeAllocator);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    bool Octree<Allocator, NodeLayout>::OctreeNode::instantiateChildren(Octree& octree, NodeAllocator& allocator)
     {
         if (children != NodeRef{})
         {
             return false;
         }
-        OctreeNode* memory = Octree::forest[tree]->allocateNodes(8);
-        children = Octree::forest[tree]->translate(memory);
-        Octree::forest[tree]->constructNode(memory + 0, layer + 1, this, 0, 0, 0);
-        Octree::forest[tree]->constructNode(memory + 1, layer + 1, this, 0, 0, 1);
-        Octree::forest[tree]->constructNode(memory + 2, layer + 1, this, 0, 1, 0);
-        Octree::forest[tree]->constructNode(memory + 3, layer + 1, this, 0, 1, 1);
-        Octree::forest[tree]->constructNode(memory + 4, layer + 1, this, 1, 0, 0);
-        Octree::forest[tree]->constructNode(memory + 5, layer + 1, this, 1, 0, 1);
-        Octree::forest[tree]->constructNode(memory + 6, layer + 1, this, 1, 1, 0);
-        Octree::forest[tree]->constructNode(memory + 7, layer + 1, this, 1, 1, 1);
-        if (layer + 1 < Octree::forest[tree]->minLayer)
-        {
-            memory[0].instantiateChildren();
-            memory[1].instantiateChildren();
-            memory[2].instantiateChildren();
-            memory[3].instantiateChildren();
-            memory[4].instantiateChildren();
-            memory[5].instantiateChildren();
-            memory[6].instantiateChildren();
-            memory[7].instantiateChildren();
+        OctreeNode* memory = octree.allocateNodes(allocator, 8);
+        children = octree.translate(memory);
+        octree.constructNode(allocator, memory + 0, layer + 1, this, 0, 0, 0);
+        octree.constructNode(allocator, memory + 1, layer + 1, this, 0, 0, 1);
+        octree.constructNode(allocator, memory + 2, layer + 1, this, 0, 1, 0);
+        octree.constructNode(allocator, memory + 3, layer + 1, this, 0, 1, 1);
+        octree.constructNode(allocator, memory + 4, layer + 1, this, 1, 0, 0);
+        octree.constructNode(allocator, memory + 5, layer + 1, this, 1, 0, 1);
+        octree.constructNode(allocator, memory + 6, layer + 1, this, 1, 1, 0);
+        octree.constructNode(allocator, memory + 7, layer + 1, this, 1, 1, 1);
+        if (layer + 1 < octree.minLayer)
+        {
+            memory[0].instantiateChildren(octree, allocator);
+            memory[1].instantiateChildren(octree, allocator);
+            memory[2].instantiateChildren(octree, allocator);
+            memory[3].instantiateChildren(octree, allocator);
+            memory[4].instantiateChildren(octree, allocator);
+            memory[5].instantiateChildren(octree, allocator);
+            memory[6].instantiateChildren(octree, allocator);
+            memory[7].instantiateChildren(octree, allocator);
         }
         return true;
     }
 
-    template<typename Allocator>
-    float Octree<Allocator>::OctreeNode::size() const
+    template<typename Allocator, typename NodeLayout>
+    float Octree<Allocator, NodeLayout>::OctreeNode::size(Octree const& octree) const
+    {
+        return octree.size / (1 << layer);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    Vector3 Octree<Allocator, NodeLayout>::OctreeNode::center(Octree const& octree) const
     {
-        return Octree::forest[tree]->size / (1 << layer);
+        if constexpr (hasCompactNodes)
+        {
+            Vector3 result = Vector3{ .x = 0, .y = 0, .z = 0 };
+            for (int l = 1; l <= static_cast<int>(layer); l++)
+            {
+                int shift = layer - l;
+                result = result + octree.size / (1 << l) *
+                    cornerDirections[(worldIndex0 >> shift) & 1][(worldIndex1 >> shift) & 1][(worldIndex2 >> shift) & 1];
+            }
+            return result;
+        }
+        else
+        {
+            return this->centerPosition;
+        }
     }
 
-    template<typename Allocator>
-    void Octree<Allocator>::OctreeNode::leaves(std::vector<OctreeNode*>& result)
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::OctreeNode::leaves(Octree& octree, std::vector<OctreeNode*>& result)
     {
-        OctreeNode* childrenBase = Octree::forest[tree]->resolve(children);
+        OctreeNode* childrenBase = octree.resolve(children);
         if (childrenBase != nullptr)
         {
-            childrenBase[0].leaves(result);
-            childrenBase[1].leaves(result);
-            childrenBase[2].leaves(result);
-            childrenBase[3].leaves(result);
-            childrenBase[4].leaves(result);
-            childrenBase[5].leaves(result);
-            childrenBase[6].leaves(result);
-            childrenBase[7].leaves(result);
+            childrenBase[0].leaves(octree, result);
+            childrenBase[1].leaves(octree, result);
+            childrenBase[2].leaves(octree, result);
+            childrenBase[3].leaves(octree, result);
+            childrenBase[4].leaves(octree, result);
+            childrenBase[5].leaves(octree, result);
+            childrenBase[6].leaves(octree, result);
+            childrenBase[7].leaves(octree, result);
         }
         else
         {
@@ -105,108 +154,134 @@ namespace GraphGenerator
         }
     }
 
-    template<typename Allocator>
-    bool Octree<Allocator>::OctreeNode::contains(Vector3 const& point)
+    template<typename Allocator, typename NodeLayout>
+    bool Octree<Allocator, NodeLayout>::OctreeNode::contains(Octree const& octree, Vector3 const& point)
     {
-        Vector3 diff = point - centerPosition;
-        return std::abs(diff.x) <= size() && std::abs(diff.y) <= size() && std::abs(diff.z) <= size();
+        Vector3 diff = point - center(octree);
+        return std::abs(diff.x) <= size(octree) && std::abs(diff.y) <= size(octree) && std::abs(diff.z) <= size(octree);
     }
 
-    template<typename Allocator>
-    bool Octree<Allocator>::OctreeNode::intersectWithTriangle(Vector3 point1, Vector3 point2, Vector3 point3, float expansion)
+    template<typename Allocator, typename NodeLayout>
+    bool Octree<Allocator, NodeLayout>::OctreeNode::intersectWithTriangle(Octree const& octree, Vector3 point1, Vector3 point2, Vector3 point3, float expansion)
     {
-        float r = size() + expansion;
-        point1 = point1 - centerPosition;
-        point2 = point2 - centerPosition;
-        point3 = point3 - centerPosition;
-        if (std::min(point1.x, std::min(point2.x, point3.x)) >= r ||
-            std::max(point1.x, std::max(point2.x, point3.x)) <= -r ||
-            std::min(point1.y, std::min(point2.y, point3.y)) >= r ||
-            std::max(point1.y, std::max(point2.y, point3.y)) <= -r ||
-            std::min(point1.z, std::min(point2.z, point3.z)) >= r ||
-            std::max(point1.z, std::max(point2.z, point3.z)) <= -r)
-        {
-            return false;
-        }
+        return intersectWithTriangle(center(octree), size(octree), point1, point2, point3, expansion);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    bool Octree<Allocator, NodeLayout>::OctreeNode::intersectWithTriangle(Vector3 const& centerPosition, float size, Vector3 point1, Vector3 point2, Vector3 point3,
+        float expansion)
+    {
+        return triangleBoxOverlap(centerPosition, size + expansion, point1, point2, point3);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::OctreeNode::addTerrainTriangleMesh(Octree& octree, Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer,
+        float expansion, bool wasMoveable)
+    {
+        addTerrainTriangleMesh(octree, octree.nodeAllocator, point1, point2, point3, maxLayer, expansion, wasMoveable);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::OctreeNode::addTerrainTriangleMesh(Octree& octree, NodeAllocator& allocator, Vector3 const& point1, Vector3 const& point2,
+        Vector3 const& point3, int maxLayer, float expansion, bool wasMoveable)
+    {
+        insertTerrainTriangle(octree, allocator, point1, point2, point3, maxLayer, expansion, wasMoveable,
+            intersectWithTriangle(octree, point1, point2, point3, expansion));
+    }
 
-        Vector3 n = cross(point2 - point1, point3 - point1);
-        if (std::abs(dot(point1, n)) > r * (std::abs(n.x) + std::abs(n.y) + std::abs(n.z)))
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::OctreeNode::insertTerrainTriangle(Octree& octree, NodeAllocator& allocator, Vector3 const& point1, Vector3 const& point2,
+        Vector3 const& point3, int maxLayer, float expansion, bool wasMoveable, bool intersects)
+    {
+        if (isMoveable || wasMoveable || (layer >= octree.minLayer && expansion - size(octree) > 0 &&
+            ((point1 + point2 + point3) / 3 - center(octree)).sqrLength() < (expansion - size(octree)) * (expansion - size(octree))))
         {
-            return false;
+            isContainsMoveableChildren = true;
+            isMoveable = true;
+            return;
         }
-
-        for (int i = 0; i < 3; i++)
+        if (intersects)
         {
-            // j = 0
-            Vector3 ai = Vector3{ .x = 0, .y = 0, .z = 0 };
-            ai[i] = 1;
-            Vector3 a = cross(ai, point3 - point2);
-            float d1 = dot(point1, a);
-            float d2 = dot(point2, a);
-            float rr = r * (std::abs(a[(i + 1) % 3]) + std::abs(a[(i + 2) % 3]));
-            if (std::min(d1, d2) > rr || std::max(d1, d2) < -rr)
-            {
-                return false;
-            }
-            // j = 1
-            a = cross(ai, point1 - point3);
-            d1 = dot(point2, a);
-            d2 = dot(point3, a);
-            rr = r * (std::abs(a[(i + 1) % 3]) + std::abs(a[(i + 2) % 3]));
-            if (std::min(d1, d2) > rr || std::max(d1, d2) < -rr)
+            isContainsMoveableChildren = true;
+            if (layer < maxLayer and octree.canRefine(this))
             {
-                return false;
+                instantiateChildren(octree, allocator);
+                OctreeNode* childrenBase = octree.resolve(children);
+                unsigned int overlaps = triangleChildrenOverlap(center(octree), childrenBase[0].size(octree), expansion, point1, point2, point3);
+                for (int r = 0; r < 8; r++)
+                {
+                    childrenBase[r].insertTerrainTriangle(octree, allocator, point1, point2, point3, maxLayer, expansion, isMoveable,
+                        (overlaps >> r) & 1);
+                }
             }
-            // j = 2
-            a = cross(ai, point2 - point1);
-            d1 = dot(point3, a);
-            d2 = dot(point1, a);
-            rr = r * (std::abs(a[(i + 1) % 3]) + std::abs(a[(i + 2) % 3]));
-            if (std::min(d1, d2) > rr || std::max(d1, d2) < -rr)
+            else
             {
-                return false;
+                isMoveable = true;
             }
         }
-        return true;
     }
 
-    template<typename Allocator>
-    void Octree<Allocator>::OctreeNode::addTerrainTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer,
-        float expansion, bool wasMoveable)
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::OctreeNode::addTerrainTriangleList(Octree& octree, NodeAllocator& allocator, TriangleBatch const& batch,
+        std::span<int const> triangles, int maxLayer, std::vector<std::array<std::vector<int>, 8>>& lists, LeafTriangles* kept)
     {
-        if (isMoveable || wasMoveable || (layer >= Octree::forest[tree]->minLayer && expansion - size() > 0 &&
-            ((point1 + point2 + point3) / 3 - centerPosition).sqrLength() < (expansion - size()) * (expansion - size())))
+        isContainsMoveableChildren = true;
+        if (kept != nullptr and (isMoveable or layer >= maxLayer or not octree.canRefine(this)))
         {
-            isContainsMoveableChildren = true;
             isMoveable = true;
+            kept->add(this, triangles);
             return;
         }
-        if (intersectWithTriangle(point1, point2, point3, expansion))
+        if (isMoveable)
         {
-            isContainsMoveableChildren = true;
-            if (layer < maxLayer)
-            {
-                instantiateChildren();
-                OctreeNode* childrenBase = Octree::forest[tree]->resolve(children);
-                childrenBase[0].addTerrainTriangleMesh(point1, point2, point3, maxLayer, expansion, isMoveable);
-                childrenBase[1].addTerrainTriangleMesh(point1, point2, point3, maxLayer, expansion, isMoveable);
-                childrenBase[2].addTerrainTriangleMesh(point1, point2, point3, maxLayer, expansion, isMoveable);
-                childrenBase[3].addTerrainTriangleMesh(point1, point2, point3, maxLayer, expansion, isMoveable);
-                childrenBase[4].addTerrainTriangleMesh(point1, point2, point3, maxLayer, expansion, isMoveable);
-                childrenBase[5].addTerrainTriangleMesh(point1, point2, point3, maxLayer, expansion, isMoveable);
-                childrenBase[6].addTerrainTriangleMesh(point1, point2, point3, maxLayer, expansion, isMoveable);
-                childrenBase[7].addTerrainTriangleMesh(point1, point2, point3, maxLayer, expansion, isMoveable);
+            return;
+        }
+        if (layer >= maxLayer)
+        {
+            isMoveable = true;
+            return;
+        }
+        instantiateChildren(octree, allocator);
+        OctreeNode* childrenBase = octree.resolve(children);
+        float childSize = childrenBase[0].size(octree);
+        Vector3 centerPosition = center(octree);
+        auto& childLists = lists[layer + 1];
+        for (auto& list : childLists)
+        {
+            list.clear();
+        }
+        for (int t : triangles)
+        {
+            unsigned int overlaps = triangleChildrenOverlap(centerPosition, childSize, 0, batch.vertices[batch.indices[t * 3 + 0]],
+                batch.vertices[batch.indices[t * 3 + 1]], batch.vertices[batch.indices[t * 3 + 2]]);
+            for (int r = 0; r < 8; r++)
+            {
+                if ((overlaps >> r) & 1)
+                {
+                    childLists[r].push_back(t);
+                }
             }
-            else
+        }
+        for (int r = 0; r < 8; r++)
+        {
+            if (not childLists[r].empty())
             {
-                isMoveable = true;
+                childrenBase[r].addTerrainTriangleList(octree, allocator, batch, childLists[r], maxLayer, lists, kept);
             }
         }
     }
 
-    template<typename Allocator>
-    void Octree<Allocator>::OctreeNode::addRuntimeTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::OctreeNode::addRuntimeTriangleMesh(Octree& octree, Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
         int maxLayer, float expansion, int runtimeMeshIndex, std::unordered_set<OctreeNode*>& influencedOctreeNodes, bool wasMoveable)
+    {
+        insertRuntimeTriangle(octree, point1, point2, point3, maxLayer, expansion, runtimeMeshIndex, influencedOctreeNodes, wasMoveable,
+            intersectWithTriangle(octree, point1, point2, point3, expansion));
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::OctreeNode::insertRuntimeTriangle(Octree& octree, Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
+        int maxLayer, float expansion, int runtimeMeshIndex, std::unordered_set<OctreeNode*>& influencedOctreeNodes, bool wasMoveable, bool intersects)
     {
         if (isMoveable || wasMoveable)
         {
@@ -214,63 +289,53 @@ namespace GraphGenerator
             isMoveable = true;
             return;
         }
-        if (intersectWithTriangle(point1, point2, point3, expansion))
+        if (intersects)
         {
             isContainsRuntimeMoveableChildren = true;
-            if (layer < maxLayer)
+            if (layer < maxLayer and octree.canRefine(this))
             {
                 // This node was a leaf node before add runtime triangle, recalculate path edge is required.
-                instantiateChildren();
-                OctreeNode* childrenBase = Octree::forest[tree]->resolve(children);
-                auto edgesView = pathGraphEdges.view();
+                instantiateChildren(octree);
+                OctreeNode* childrenBase = octree.resolve(children);
+                auto edgesView = octree.pathGraphEdgesOf(this);
                 if (not edgesView.empty())
                 {
-                    Octree::forest[tree]->toRecalculatePathGraph.insert(this);
+                    octree.toRecalculatePathGraph.insert(this);
                     for (NodeRef i : edgesView)
                     {
-                        Octree::forest[tree]->toRecalculatePathGraph.insert(Octree::forest[tree]->resolve(i));
+                        octree.toRecalculatePathGraph.insert(octree.resolve(i));
                     }
                 }
-                childrenBase[0].addRuntimeTriangleMesh(point1, point2, point3, maxLayer,
-                    expansion, runtimeMeshIndex, influencedOctreeNodes, isMoveable);
-                childrenBase[1].addRuntimeTriangleMesh(point1, point2, point3, maxLayer,
-                    expansion, runtimeMeshIndex, influencedOctreeNodes, isMoveable);
-                childrenBase[2].addRuntimeTriangleMesh(point1, point2, point3, maxLayer,
-                    expansion, runtimeMeshIndex, influencedOctreeNodes, isMoveable);
-                childrenBase[3].addRuntimeTriangleMesh(point1, point2, point3, maxLayer,
-                    expansion, runtimeMeshIndex, influencedOctreeNodes, isMoveable);
-                childrenBase[4].addRuntimeTriangleMesh(point1, point2, point3, maxLayer,
-                    expansion, runtimeMeshIndex, influencedOctreeNodes, isMoveable);
-                childrenBase[5].addRuntimeTriangleMesh(point1, point2, point3, maxLayer,
-                    expansion, runtimeMeshIndex, influencedOctreeNodes, isMoveable);
-                childrenBase[6].addRuntimeTriangleMesh(point1, point2, point3, maxLayer,
-                    expansion, runtimeMeshIndex, influencedOctreeNodes, isMoveable);
-                childrenBase[7].addRuntimeTriangleMesh(point1, point2, point3, maxLayer,
-                    expansion, runtimeMeshIndex, influencedOctreeNodes, isMoveable);
+                unsigned int overlaps = triangleChildrenOverlap(center(octree), childrenBase[0].size(octree), expansion, point1, point2, point3);
+                for (int r = 0; r < 8; r++)
+                {
+                    childrenBase[r].insertRuntimeTriangle(octree, point1, point2, point3, maxLayer, expansion, runtimeMeshIndex,
+                        influencedOctreeNodes, isMoveable, (overlaps >> r) & 1);
+                }
             }
             else if (bool newElementInserted = influencedOctreeNodes.insert(this).second;
                 newElementInserted == true)
             {
                 runtimeMoveableCounter++;
-                Octree::forest[tree]->toRecalculatePathGraph.insert(this);
-                for (NodeRef toRef : pathGraphEdges.view())
+                octree.toRecalculatePathGraph.insert(this);
+                for (NodeRef toRef : octree.pathGraphEdgesOf(this))
                 {
-                    auto to = Octree::forest[tree]->resolve(toRef);
-                    Octree::forest[tree]->toRecalculatePathGraph.insert(to);
+                    auto to = octree.resolve(toRef);
+                    octree.toRecalculatePathGraph.insert(to);
                 }
             }
         }
         // This is a new node which was created just now
-        else if ((children == NodeRef{}) and (pathGraphEdges.view().empty()))
+        else if ((children == NodeRef{}) and (octree.pathGraphEdgesOf(this).empty()))
         {
-            Octree::forest[tree]->toRecalculatePathGraph.insert(this);
+            octree.toRecalculatePathGraph.insert(this);
         }
     }
 
-    template<typename Allocator>
-    void Octree<Allocator>::OctreeNode::checkContainsRuntimeMoveableChildrenWhenRemove()
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::OctreeNode::checkContainsRuntimeMoveableChildrenWhenRemove(Octree& octree)
     {
-        OctreeNode* childrenBase = Octree::forest[tree]->resolve(children);
+        OctreeNode* childrenBase = octree.resolve(children);
         if (childrenBase != nullptr)
         {
             if (childrenBase[0].isContainsRuntimeMoveableChildren)
@@ -307,335 +372,1587 @@ namespace GraphGenerator
             }
         }
         isContainsRuntimeMoveableChildren = false;
-        OctreeNode* parentPointer = Octree::forest[tree]->resolve(parent);
+        OctreeNode* parentPointer = octree.parentOf(this);
         if (parentPointer != nullptr)
         {
-            parentPointer->checkContainsRuntimeMoveableChildrenWhenRemove();
+            parentPointer->checkContainsRuntimeMoveableChildrenWhenRemove(octree);
         }
     }
 
-    template<typename Allocator>
-    void Octree<Allocator>::OctreeNode::removeRuntimeMesh(int runtimeMeshIndex)
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::OctreeNode::removeRuntimeMesh(Octree& octree, int runtimeMeshIndex)
     {
         if (runtimeMoveableCounter != 0)
         {
             runtimeMoveableCounter--;
             if (runtimeMoveableCounter == 0)
             {
-                checkContainsRuntimeMoveableChildrenWhenRemove();
+                checkContainsRuntimeMoveableChildrenWhenRemove(octree);
             }
         }
     }
 
-    template<typename Allocator>
-    Octree<Allocator>::Octree(PathGraph<Octree>* graph, float size, float radius, int minLayer, NodeAllocator&& nodeAllocator) :
+    template<typename Allocator, typename NodeLayout>
+    Octree<Allocator, NodeLayout>::Octree(PathGraph<Octree>* graph, float size, float radius, int minLayer, NodeAllocator&& nodeAllocator) :
         nodeAllocator{ nodeAllocator }
     {
-        if (Octree<Allocator>::availableIndex.empty())
-        {
-            this->index = Octree<Allocator>::forest.size();
-            forest.push_back(this);
-        }
-        else
-        {
-            this->index = Octree::availableIndex.top();
-            Octree::availableIndex.pop();
-            forest[index] = this;
-        }
         this->graph = graph;
         this->size = size;
         this->radius = radius;
         this->minLayer = minLayer;
         root = allocateNodes(1);
         constructNode(root, 0, nullptr, 0, 0, 0);
-        root->instantiateChildren();
+        root->instantiateChildren(*this);
     }
 
-    template<typename Allocator>
-    Octree<Allocator>::~Octree()
+    template<typename Allocator, typename NodeLayout>
+    Octree<Allocator, NodeLayout>::Octree(PathGraph<Octree>* graph, std::string const& snapshotPath)
     {
-        destroyNode(root);
-        deallocateNodes(root, 1);
-        Octree::availableIndex.push(index);
-        Octree::forest[index] = nullptr;
-    }
-
-    template<typename Allocator>
-    void Octree<Allocator>::addTerrainTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
-        int maxLayer, bool considerRadius)
-    {
-        root->addTerrainTriangleMesh(point1, point2, point3, maxLayer < 15 ? maxLayer : 15, considerRadius ? radius : 0);
-    }
-
-    template<typename Allocator>
-    void Octree<Allocator>::addRuntimeTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
-        int maxLayer, bool considerRadius, int runtimeMeshIndex)
-    {
-        root->addRuntimeTriangleMesh(point1, point2, point3, maxLayer < 15 ? maxLayer : 15, considerRadius ? radius : 0,
-            runtimeMeshIndex, runtimeMeshIndexToNodes[runtimeMeshIndex]);
-    }
-
-    template<typename Allocator>
-    void Octree<Allocator>::removeRuntimeMesh(int runtimeMeshIndex)
-    {
-        if (runtimeMeshIndexToNodes.find(runtimeMeshIndex) == runtimeMeshIndexToNodes.end())
+        static_assert(sizeof(NodeRef) == sizeof(std::uint32_t), "snapshots store handles as uint32");
+        auto const snapshot = OctreeSnapshotFile{ snapshotPath };
+        auto const& header = snapshot.header();
+        if (header.nodeSize != sizeof(OctreeNode))
         {
-            return;
+            throw std::runtime_error{ "OCTREE snapshot of a build with another node layout!" };
         }
-        else
+        for (auto const& segment : snapshot.segments())
         {
-            for (auto i : runtimeMeshIndexToNodes[runtimeMeshIndex])
+            nodeAllocator.mapSegment(snapshotPath, segment.offset, static_cast<std::size_t>(segment.bytes));
+        }
+
+        // Every handle of the metadata has to be a whole node of the mapped segments, the nodes themselves are taken as they are
+        auto const spans = nodeAllocator.usedSpans();
+        auto node = [&](std::uint32_t handle)
+        {
+            OctreeNode* result = resolve(NodeRef{ handle });
+            auto address = reinterpret_cast<std::uintptr_t>(result);
+            for (auto const& span : spans)
             {
-                i->removeRuntimeMesh(runtimeMeshIndex);
-                if (i->runtimeMoveableCounter == 0)
+                auto begin = reinterpret_cast<std::uintptr_t>(span.data());
+                if (handle != 0 and address >= begin and address - begin + sizeof(OctreeNode) <= span.size())
                 {
-                    toRecalculatePathGraph.insert(i);
+                    return result;
                 }
             }
-            runtimeMeshIndexToNodes.erase(runtimeMeshIndex);
-        }
-    }
-
-    template<typename Allocator>
-    typename Octree<Allocator>::OctreeNode* Octree<Allocator>::positionToNode(Vector3 const& position)
-    {
-        OctreeNode* node = root;
-        while (node->children and node->runtimeMoveableCounter == 0)
-        {
-            Vector3 diff = position - node->centerPosition;
-            unsigned offset = 4U * (diff.x <= 0) + 2U * (diff.y <= 0) + (diff.z <= 0);
-            node = resolve(node->children + offset);
-        }
-        return node;
-    }
-
-    template<typename Allocator>
-    bool Octree<Allocator>::lineOfSight(Vector3 const& from, Vector3 const& to)
-    {
-        float length = (from - to).length();
-        Vector3 direction = (from - to) / length;
-        float constexpr fLowest = std::numeric_limits<float>::lowest();
-        float constexpr fMax = std::numeric_limits<float>::max();
-        // prevent nan in intersectWithRayBox
-        float invDirX = std::clamp(1.f / direction.x, fLowest, fMax);
-        float invDirY = std::clamp(1.f / direction.y, fLowest, fMax);
-        float invDirZ = std::clamp(1.f / direction.z, fLowest, fMax);
-
-        struct Stack : std::stack<NodeRef, std::vector<NodeRef>>
+            throw std::runtime_error{ "Corrupted OCTREE snapshot!" };
+        };
+        auto metadata = snapshot.metadata();
+        std::size_t position = 0;
+        auto read = [&](std::size_t count)
         {
-            Stack()
+            if (count > metadata.size() - position)
             {
-                this->c.reserve(256);
+                throw std::runtime_error{ "Corrupted OCTREE snapshot!" };
             }
+            position += count;
+            return metadata.subspan(position - count, count);
         };
-        Stack workList{};
-        workList.push(translate(root));
-        while (workList.size() != 0)
+        // Every counted element takes at least one more uint32
+        auto readCount = [&]()
         {
-            OctreeNode* node = resolve(workList.top());
-            workList.pop();
-            if (!node->isContainsMoveableChildren && !node->isContainsRuntimeMoveableChildren)
+            std::uint32_t count = read(1)[0];
+            if (count > metadata.size() - position)
             {
-                continue;
+                throw std::runtime_error{ "Corrupted OCTREE snapshot!" };
             }
-            // Due to some strange reason, " * 1.01" can eliminate "false positive"
-            Vector3 constexpr oneWithEpsilon = Vector3{ .x = 1.01f, .y = 1.01f, .z = 1.01f };
-            Vector3 enlargedSize = oneWithEpsilon * node->size();
-            if (intersectRayBox(node->centerPosition - enlargedSize, node->centerPosition + enlargedSize, to, invDirX, invDirY, invDirZ, length))
+            return count;
+        };
+
+        components.resize(readCount());
+        for (auto& component : components)
+        {
+            auto handles = read(readCount());
+            component.reserve(handles.size());
+            for (std::uint32_t handle : handles)
             {
-                if (node->children != NodeRef{})
-                {
-                    workList.push(node->children + 0);
-                    workList.push(node->children + 1);
-                    workList.push(node->children + 2);
-                    workList.push(node->children + 3);
-                    workList.push(node->children + 4);
-                    workList.push(node->children + 5);
-                    workList.push(node->children + 6);
-                    workList.push(node->children + 7);
-                }
-                else
-                {
-                    if (node->isMoveable || node->runtimeMoveableCounter != 0)
-                    {
-                        return false;
-                    }
-                }
+                component.push_back(node(handle));
             }
         }
-        return true;
-    }
-
-    // 0 = +x, 1 = -x, 2 = +y, 3 = -y, 4 = +z, 5 = -z
-    template<typename Allocator>
-    typename Octree<Allocator>::OctreeNode* Octree<Allocator>::findAdjacentNode(OctreeNode* node, int directionIndex)
-    {
-        return findAdjacentNode(node->worldIndex0 + adjacentDirections[directionIndex][0],
-            node->worldIndex1 + adjacentDirections[directionIndex][1],
-            node->worldIndex2 + adjacentDirections[directionIndex][2],
-            node->layer);
-    }
-
-    template<typename Allocator>
-    void Octree<Allocator>::updateSCC()
-    {
-        componentMap.clear();
-        std::vector<OctreeNode*> leaves;
-        leaves.reserve(numberOfNodes);
-        root->leaves(leaves);
-        int currentConnectComponentIndex = 1;
-        int nodesNumber = 0;
-        for (OctreeNode* q : leaves)
+        for (std::uint32_t index : read(readCount()))
         {
-            if (q->pathGraphEdges.valid())
+            if (index == 0 or index > components.size())
             {
-                nodesNumber++;
-                if (q->pathGraphConnectComponentIndex == OctreeNode::invalidComponentIndex)
-                {
-                    int count = 1;
-                    q->pathGraphConnectComponentIndex = currentConnectComponentIndex;
-                    std::list<PathGraphData*> workList{ &(q->pathGraphEdges) };
-                    while (not workList.empty())
-                    {
-                        PathGraphData* nextEdges = *workList.begin();
-                        workList.pop_front();
-                        for (NodeRef toRef : nextEdges->view())
-                        {
-                            OctreeNode* to = resolve(toRef);
-                            if (to->pathGraphConnectComponentIndex != currentConnectComponentIndex)
-                            {
-                                count++;
-                                to->pathGraphConnectComponentIndex = currentConnectComponentIndex;
-                                workList.push_back(&(to->pathGraphEdges));
-                            }
-                        }
-                    }
-                    componentMap.insert({ currentConnectComponentIndex, { q, count } });
-                    // Prevent overflow
-                    if (currentConnectComponentIndex != OctreeNode::maxComponentIndex)
-                    {
-                        currentConnectComponentIndex++;
-                    }
-                }
+                throw std::runtime_error{ "Corrupted OCTREE snapshot!" };
             }
+            emptyComponents.insert(index);
         }
-        // Prevent overflow
-        for (OctreeNode* q : leaves)
+        FrozenPathGraph& frozen = frozenPathGraph;
+        auto leaves = read(readCount());
+        frozen.leaves.reserve(leaves.size());
+        for (std::uint32_t handle : leaves)
         {
-            if (q->pathGraphConnectComponentIndex == OctreeNode::maxComponentIndex)
+            frozen.leaves.push_back(node(handle));
+        }
+        auto offsets = read(leaves.size() + 1);
+        auto targets = read(readCount());
+        if constexpr (hasCompactNodes)
+        {
+            // The rows of the nodes, in the order componentIndex, componentPosition, leafIndex
+            std::uint32_t rows = read(1)[0];
+            if (rows > (metadata.size() - position) / 3)
             {
-                q->pathGraphConnectComponentIndex = OctreeNode::invalidComponentIndex;
+                throw std::runtime_error{ "Corrupted OCTREE snapshot!" };
             }
+            compactNodeRows = rows;
+            auto componentIndex = read(rows);
+            auto componentPosition = read(rows);
+            auto leafIndex = read(rows);
+            compactNodeData.componentIndex.assign(componentIndex.begin(), componentIndex.end());
+            compactNodeData.componentPosition.assign(componentPosition.begin(), componentPosition.end());
+            compactNodeData.leafIndex.assign(leafIndex.begin(), leafIndex.end());
+            compactNodeData.edges.resize(rows);
         }
-        graph->nodesNumber = nodesNumber;
+        if (offsets.front() != 0 or offsets.back() != targets.size() or not std::is_sorted(offsets.begin(), offsets.end()) or
+            position != metadata.size() or header.largestComponent < 0 or static_cast<std::size_t>(header.largestComponent) > components.size())
+        {
+            throw std::runtime_error{ "Corrupted OCTREE snapshot!" };
+        }
+        frozen.offsets.assign(offsets.begin(), offsets.end());
+        frozen.targets.reserve(targets.size());
+        for (std::uint32_t handle : targets)
+        {
+            node(handle);
+            frozen.targets.push_back(NodeRef{ handle });
+        }
+
+        this->graph = graph;
+        size = header.size;
+        radius = header.radius;
+        minLayer = header.minLayer;
+        root = node(header.root);
+        numberOfNodes = static_cast<std::size_t>(header.numberOfNodes);
+        largestComponent = header.largestComponent;
+        graph->nodesNumber = header.nodesNumber;
+        isPathGraphFrozen = true;
     }
 
-    template<typename Allocator>
-    void Octree<Allocator>::calculateTerrainPathGraph()
+    template<typename Allocator, typename NodeLayout>
+    Octree<Allocator, NodeLayout>::Octree(PathGraph<Octree>* graph, Octree& other)
     {
-        std::vector<OctreeNode*> leaves;
-        root->leaves(leaves);
-        for (OctreeNode* q : leaves)
+        if constexpr (not detect_used_spans_method<NodeAllocator>::has_used_spans_method)
         {
-            q->pathGraphEdges = {};
+            throw std::logic_error{ "only octrees in a memory pool can be cloned" };
         }
-        for (OctreeNode* q : leaves)
+        else
         {
-            if (q->isMoveable)
+            // Same segments and offsets, so every handle means the same node in both octrees
+            for (auto const& span : other.nodeAllocator.usedSpans())
             {
-                if (q->layer == 0)
-                {
-                    continue;
-                }
-                NodeRef nRef = translate(q);
-                for (int i = 0; i < 6; i++)
+                nodeAllocator.copySegment(span);
+            }
+            auto node = [&](OctreeNode* otherNode)
+            {
+                return resolve(other.translate(otherNode));
+            };
+
+            // Edge arrays live outside of the arena, every node that has one gets its own copy
+            if constexpr (hasCompactNodes)
+            {
+                compactNodeRows = other.compactNodeRows.load();
+                compactNodeData.componentIndex = other.compactNodeData.componentIndex;
+                compactNodeData.componentPosition = other.compactNodeData.componentPosition;
+                compactNodeData.leafIndex = other.compactNodeData.leafIndex;
+                compactNodeData.edges.resize(other.compactNodeData.edges.size());
+                for (std::size_t row = 0; row < compactNodeData.edges.size(); row++)
                 {
-                    auto found = findAdjacentNode(q->worldIndex0 + adjacentDirections[i][0],
-                        q->worldIndex1 + adjacentDirections[i][1],
-                        q->worldIndex2 + adjacentDirections[i][2],
-                        q->layer);
-                    if (found == nullptr || !found->isMoveable)
+                    for (NodeRef edge : other.compactNodeData.edges[row].view())
                     {
-                        continue;
+                        compactNodeData.edges[row].add(edge);
                     }
-                    if (found->layer < q->layer || found->children == NodeRef{})
+                }
+            }
+            else
+            {
+                std::vector<NodeRef> stack{ other.translate(other.root) };
+                while (not stack.empty())
+                {
+                    NodeRef ref = stack.back();
+                    stack.pop_back();
+                    OctreeNode* from = other.resolve(ref);
+                    OctreeNode* to = resolve(ref);
+                    if (from->pathGraphEdges.valid())
                     {
-                        auto qEdges = q->pathGraphEdges.view();
-                        auto foundEdges = found->pathGraphEdges.view();
-                        NodeRef nFoundRef = translate(found);
-                        if (qEdges.end() == std::find(qEdges.begin(), qEdges.end(), nFoundRef))
+                        // The copied bytes still own the array of from
+                        new (&to->pathGraphEdges) PathGraphData{};
+                        for (NodeRef edge : from->pathGraphEdges.view())
                         {
-                            q->pathGraphEdges.add(nFoundRef);
+                            to->pathGraphEdges.add(edge);
                         }
-                        if (foundEdges.end() == std::find(foundEdges.begin(), foundEdges.end(), nRef))
+                    }
+                    if (from->children != NodeRef{})
+                    {
+                        for (int r = 0; r < 8; r++)
                         {
-                            found->pathGraphEdges.add(nRef);
+                            stack.push_back(from->children + r);
                         }
                     }
                 }
             }
-        }
-        updateSCC();
-    }
 
-    template<typename Allocator>
-    void Octree<Allocator>::calculateRuntimePathGraph()
-    {
-        for (auto q : toRecalculatePathGraph)
-        {
-            NodeRef qRef = translate(q);
-            for (auto i : q->pathGraphEdges.view())
+            this->graph = graph;
+            size = other.size;
+            radius = other.radius;
+            minLayer = other.minLayer;
+            root = node(other.root);
+            numberOfNodes = other.numberOfNodes.load();
+            nodeBudget = other.nodeBudget;
+            components.resize(other.components.size());
+            for (std::size_t i = 0; i < components.size(); i++)
             {
-                resolve(i)->pathGraphEdges.remove(qRef);
+                components[i].reserve(other.components[i].size());
+                for (OctreeNode* q : other.components[i])
+                {
+                    components[i].push_back(node(q));
+                }
             }
-            q->pathGraphEdges = {};
-            if (!q->isMoveable && q->runtimeMoveableCounter == 0 && q->children == NodeRef{})
+            emptyComponents = other.emptyComponents;
+            largestComponent = other.largestComponent;
+            frozenPathGraph.leaves.reserve(other.frozenPathGraph.leaves.size());
+            for (OctreeNode* leaf : other.frozenPathGraph.leaves)
             {
-                q->pathGraphEdges = {};
+                frozenPathGraph.leaves.push_back(node(leaf));
             }
-        }
-        for (auto q : toRecalculatePathGraph)
-        {
-            if (!q->isMoveable && q->runtimeMoveableCounter == 0 && q->children == NodeRef{})
+            frozenPathGraph.offsets = other.frozenPathGraph.offsets;
+            frozenPathGraph.targets = other.frozenPathGraph.targets;
+            isPathGraphFrozen = other.isPathGraphFrozen;
+            for (auto const& [index, nodes] : other.runtimeMeshIndexToNodes)
             {
-                if (q->layer == 0)
-                {
-                    continue;
-                }
-                NodeRef nRef = translate(q);
-                for (int i = 0; i < 6; i++)
+                auto& cloned = runtimeMeshIndexToNodes[index];
+                for (OctreeNode* q : nodes)
                 {
-                    auto found = findAdjacentNode(q->worldIndex0 + adjacentDirections[i][0],
-                        q->worldIndex1 + adjacentDirections[i][1],
-                        q->worldIndex2 + adjacentDirections[i][2],
-                        q->layer);
-                    if (found == nullptr || found->isMoveable || found->runtimeMoveableCounter != 0) continue;
-                    if (found->layer < q->layer || found->children == NodeRef{})
-                    {
-                        auto qEdges = q->pathGraphEdges.view();
-                        auto foundEdges = found->pathGraphEdges.view();
-                        NodeRef nFoundRef = translate(found);
-
-                        if (qEdges.end() == std::find(qEdges.begin(), qEdges.end(), nFoundRef))
-                        {
-                            q->pathGraphEdges.add(nFoundRef);
-                        }
-                        if (foundEdges.end() == std::find(foundEdges.begin(), foundEdges.end(), nRef))
-                        {
-                            found->pathGraphEdges.add(nRef);
-                        }
-                    }
+                    cloned.insert(node(q));
                 }
             }
+            for (OctreeNode* q : other.toRecalculatePathGraph)
+            {
+                toRecalculatePathGraph.insert(node(q));
+            }
+            isRefinable = other.isRefinable;
+            keptVertices = other.keptVertices;
+            keptIndices = other.keptIndices;
+            leafTriangles.leaves.reserve(other.leafTriangles.leaves.size());
+            for (OctreeNode* leaf : other.leafTriangles.leaves)
+            {
+                leafTriangles.leaves.push_back(node(leaf));
+            }
+            leafTriangles.offsets = other.leafTriangles.offsets;
+            leafTriangles.triangles = other.leafTriangles.triangles;
         }
-        toRecalculatePathGraph.clear();
-        updateSCC();
     }
 
-    template<typename Allocator>
-    int Octree<Allocator>::samplePosition(Vector3 position, float radius, int scc, Vector3& result)
+    template<typename Allocator, typename NodeLayout>
+    Octree<Allocator, NodeLayout>::~Octree()
     {
-        if (std::abs(position.x) > size || std::abs(position.y) > size || std::abs(position.z) > size)
+        destroyNode(root);
+        deallocateNodes(root, 1);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::save(std::string const& path)
+    {
+        if constexpr (not detect_used_spans_method<NodeAllocator>::has_used_spans_method)
+        {
+            throw std::logic_error{ "only octrees in a memory pool can be saved" };
+        }
+        else
+        {
+            static_assert(sizeof(NodeRef) == sizeof(std::uint32_t), "snapshots store handles as uint32");
+            if (not isPathGraphFrozen or not runtimeMeshIndexToNodes.empty() or not toRecalculatePathGraph.empty())
+            {
+                throw std::logic_error{ "call calculateTerrainPathGraph before saving, runtime meshes cannot be saved" };
+            }
+            // The graph is only read. calculateTerrainPathGraph left no edges in the nodes, so none of them points
+            // to memory outside of the arena, and nodes are not added while the path graph is frozen.
+            std::vector<std::uint32_t> metadata;
+            metadata.push_back(static_cast<std::uint32_t>(components.size()));
+            for (auto const& component : components)
+            {
+                metadata.push_back(static_cast<std::uint32_t>(component.size()));
+                for (OctreeNode* node : component)
+                {
+                    metadata.push_back(translate(node));
+                }
+            }
+            metadata.push_back(static_cast<std::uint32_t>(emptyComponents.size()));
+            metadata.insert(metadata.end(), emptyComponents.begin(), emptyComponents.end());
+            FrozenPathGraph const& frozen = frozenPathGraph;
+            metadata.push_back(static_cast<std::uint32_t>(frozen.leaves.size()));
+            for (OctreeNode* leaf : frozen.leaves)
+            {
+                metadata.push_back(translate(leaf));
+            }
+            metadata.insert(metadata.end(), frozen.offsets.begin(), frozen.offsets.end());
+            metadata.push_back(static_cast<std::uint32_t>(frozen.targets.size()));
+            metadata.insert(metadata.end(), frozen.targets.begin(), frozen.targets.end());
+            if constexpr (hasCompactNodes)
+            {
+                metadata.push_back(static_cast<std::uint32_t>(compactNodeData.componentIndex.size()));
+                metadata.insert(metadata.end(), compactNodeData.componentIndex.begin(), compactNodeData.componentIndex.end());
+                metadata.insert(metadata.end(), compactNodeData.componentPosition.begin(), compactNodeData.componentPosition.end());
+                metadata.insert(metadata.end(), compactNodeData.leafIndex.begin(), compactNodeData.leafIndex.end());
+            }
+
+            OctreeSnapshotHeader header = {};
+            header.nodeSize = sizeof(OctreeNode);
+            header.size = size;
+            header.radius = radius;
+            header.minLayer = minLayer;
+            header.root = translate(root);
+            header.largestComponent = largestComponent;
+            header.nodesNumber = graph->nodesNumber;
+            header.numberOfNodes = numberOfNodes;
+            auto spans = nodeAllocator.usedSpans();
+            writeOctreeSnapshot(path, header, spans, metadata);
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    std::vector<std::byte> Octree<Allocator, NodeLayout>::compressToDag()
+    {
+        if (not runtimeMeshIndexToNodes.empty() or not toRecalculatePathGraph.empty())
+        {
+            throw std::logic_error{ "octrees with runtime meshes cannot be compressed" };
+        }
+        auto leafSlot = [](OctreeNode const* node)
+        {
+            return node->isMoveable ? octreeDagBlocked : octreeDagEmpty;
+        };
+        OctreeDagBuilder builder;
+        if (root->children == NodeRef{})
+        {
+            return builder.finish(size, leafSlot(root), 0, numberOfNodes);
+        }
+        // Depth first, a node gets its slot once the slots of all its children are known
+        struct Visit
+        {
+            OctreeNode* children;
+            int next;
+            std::array<std::uint32_t, 8> slots;
+        };
+        std::vector<Visit> stack{ Visit{ .children = resolve(root->children), .next = 0, .slots = {} } };
+        std::uint32_t rootSlot = 0;
+        int depth = 0;
+        while (not stack.empty())
+        {
+            depth = std::max(depth, static_cast<int>(stack.size()));
+            Visit& visit = stack.back();
+            if (visit.next == 8)
+            {
+                std::uint32_t slot = builder.add(visit.slots);
+                stack.pop_back();
+                if (stack.empty())
+                {
+                    rootSlot = slot;
+                }
+                else
+                {
+                    stack.back().slots[stack.back().next++] = slot;
+                }
+                continue;
+            }
+            OctreeNode* child = visit.children + visit.next;
+            if (child->children == NodeRef{})
+            {
+                visit.slots[visit.next++] = leafSlot(child);
+            }
+            else
+            {
+                stack.push_back(Visit{ .children = resolve(child->children), .next = 0, .slots = {} });
+            }
+        }
+        return builder.finish(size, rootSlot, depth, numberOfNodes);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::addTerrainTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
+        int maxLayer, bool considerRadius)
+    {
+        if (isRefinable and considerRadius)
+        {
+            throw std::logic_error{ "refinable octrees cannot consider the radius" };
+        }
+        thawPathGraph();
+        maxLayer = maxLayer < maxSupportedLayer ? maxLayer : maxSupportedLayer;
+        if (isRefinable)
+        {
+            int first = static_cast<int>(keptVertices.size());
+            keptVertices.insert(keptVertices.end(), { point1, point2, point3 });
+            keptIndices.insert(keptIndices.end(), { first, first + 1, first + 2 });
+            addKeptTriangles(keptIndices.size() / 3 - 1, maxLayer);
+            return;
+        }
+        root->addTerrainTriangleMesh(*this, point1, point2, point3, maxLayer, considerRadius ? radius : 0);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::LeafTriangles::add(OctreeNode* leaf, std::span<int const> leafTriangles)
+    {
+        leaves.push_back(leaf);
+        triangles.insert(triangles.end(), leafTriangles.begin(), leafTriangles.end());
+        offsets.push_back(static_cast<std::uint32_t>(triangles.size()));
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    Octree<Allocator, NodeLayout>::TriangleBatch::TriangleBatch(std::span<Vector3 const> vertices, std::span<int const> indices) :
+        vertices{ vertices },
+        indices{ indices.first(indices.size() / 3 * 3) }
+    {}
+
+    template<typename Allocator, typename NodeLayout>
+    std::size_t Octree<Allocator, NodeLayout>::TriangleBatch::size() const
+    {
+        return indices.size() / 3;
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::addTerrainTriangleArrayMesh(std::span<Vector3 const> vertices, std::span<int const> indices,
+        int maxLayer, bool considerRadius, ThreadPool* pool)
+    {
+        if (isRefinable and considerRadius)
+        {
+            throw std::logic_error{ "refinable octrees cannot consider the radius" };
+        }
+        thawPathGraph();
+        float expansion = considerRadius ? radius : 0;
+        maxLayer = maxLayer < maxSupportedLayer ? maxLayer : maxSupportedLayer;
+        NodeAllocatorTraits::reserve(nodeAllocator, std::min(estimateNodeCount(indices.size() / 3, maxLayer), nodeBudget));
+        if (isRefinable)
+        {
+            std::size_t firstTriangle = keptIndices.size() / 3;
+            int offset = static_cast<int>(keptVertices.size());
+            keptVertices.insert(keptVertices.end(), vertices.begin(), vertices.end());
+            for (int index : indices.first(indices.size() / 3 * 3))
+            {
+                keptIndices.push_back(index + offset);
+            }
+            addKeptTriangles(firstTriangle, maxLayer);
+            return;
+        }
+        // With an expansion, whether a node becomes moveable depends on the order triangles arrive in, keep that one by one
+        if (expansion != 0)
+        {
+            for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                root->addTerrainTriangleMesh(*this, vertices[indices[i + 0]], vertices[indices[i + 1]], vertices[indices[i + 2]],
+                    maxLayer, expansion);
+            }
+            return;
+        }
+        TriangleBatch batch{ vertices, indices };
+        if (nodeBudget != std::numeric_limits<std::size_t>::max())
+        {
+            buildTerrainWithBudget(batch, maxLayer);
+            return;
+        }
+        if (pool != nullptr && buildTerrainSubtreesInParallel(batch, maxLayer, *pool))
+        {
+            return;
+        }
+        std::vector<int> triangles(batch.size());
+        for (std::size_t t = 0; t < triangles.size(); t++)
+        {
+            triangles[t] = static_cast<int>(t);
+        }
+        buildTerrainSubtree(root, nodeAllocator, batch, triangles, maxLayer);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    std::size_t Octree<Allocator, NodeLayout>::estimateNodeCount(std::size_t triangleCount, int maxLayer)
+    {
+        // A surface occupies about 4^layer cells of a layer, and every occupied cell gets 8 children.
+        // Twice that covers the meshes with the most surface seen so far, plus some slack for the triangles.
+        std::size_t result = 1 + triangleCount;
+        std::size_t cells = 1;
+        std::size_t surfaceCells = 2;
+        for (int layer = 0; layer < maxLayer; layer++)
+        {
+            result += 8 * std::min(cells, surfaceCells);
+            cells *= 8;
+            surfaceCells *= 4;
+        }
+        return result;
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    bool Octree<Allocator, NodeLayout>::canRefine(OctreeNode const* node) const
+    {
+        return node->children != NodeRef{} or numberOfNodes.load(std::memory_order_relaxed) + 8 <= nodeBudget;
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::addRuntimeTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
+        int maxLayer, bool considerRadius, int runtimeMeshIndex)
+    {
+        thawPathGraph();
+        root->addRuntimeTriangleMesh(*this, point1, point2, point3, maxLayer < maxSupportedLayer ? maxLayer : maxSupportedLayer,
+            considerRadius ? radius : 0,
+            runtimeMeshIndex, runtimeMeshIndexToNodes[runtimeMeshIndex]);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::removeRuntimeMesh(int runtimeMeshIndex)
+    {
+        thawPathGraph();
+        if (runtimeMeshIndexToNodes.find(runtimeMeshIndex) == runtimeMeshIndexToNodes.end())
+        {
+            return;
+        }
+        else
+        {
+            for (auto i : runtimeMeshIndexToNodes[runtimeMeshIndex])
+            {
+                i->removeRuntimeMesh(*this, runtimeMeshIndex);
+                if (i->runtimeMoveableCounter == 0)
+                {
+                    toRecalculatePathGraph.insert(i);
+                }
+            }
+            runtimeMeshIndexToNodes.erase(runtimeMeshIndex);
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::collapseToLayer(int layer)
+    {
+        // Whether a node intersects a triangle does not depend on maxLayer,
+        // so a node at the new max layer is moveable exactly when any of its children was touched by a mesh
+        layer = std::max(layer, minLayer);
+        // The rows of the leaves below the new max layer go to their ancestor on it, refineTo joins them again
+        for (OctreeNode*& leaf : leafTriangles.leaves)
+        {
+            while (static_cast<int>(leaf->layer) > layer)
+            {
+                leaf = parentOf(leaf);
+            }
+        }
+        std::vector<OctreeNode*> workList{ root };
+        while (not workList.empty())
+        {
+            OctreeNode* q = workList.back();
+            workList.pop_back();
+            OctreeNode* childrenBase = resolve(q->children);
+            if (q->layer >= layer)
+            {
+                q->destroyChildren(*this);
+                q->isMoveable = q->isMoveable || q->isContainsMoveableChildren;
+            }
+            else if (childrenBase != nullptr)
+            {
+                for (int i = 0; i < 8; i++)
+                {
+                    workList.push_back(childrenBase + i);
+                }
+            }
+        }
+        // The components and the frozen path graph may list destroyed nodes, they are found again by calculateTerrainPathGraph
+        isPathGraphFrozen = false;
+        frozenPathGraph = {};
+        components.clear();
+        emptyComponents.clear();
+        largestComponent = 0;
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::setRefinable(bool refinable)
+    {
+        if (not refinable)
+        {
+            isRefinable = false;
+            keptVertices = {};
+            keptIndices = {};
+            leafTriangles = {};
+            return;
+        }
+        if (isRefinable)
+        {
+            return;
+        }
+        if (root->isMoveable or root->isContainsMoveableChildren)
+        {
+            throw std::logic_error{ "call setRefinable before adding meshes" };
+        }
+        isRefinable = true;
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::refineTo(int layer)
+    {
+        if (not isRefinable)
+        {
+            throw std::logic_error{ "only refinable octrees can be refined, call setRefinable before adding meshes" };
+        }
+        if (not runtimeMeshIndexToNodes.empty() or not toRecalculatePathGraph.empty())
+        {
+            throw std::logic_error{ "runtime meshes have to be removed before refining" };
+        }
+        layer = std::clamp(layer, 0, maxSupportedLayer);
+        // Only a calculated path graph has components, otherwise calculateTerrainPathGraph finds the edges later
+        bool updatePathGraph = isPathGraphFrozen or not components.empty();
+        thawPathGraph();
+
+        // All rows of every leaf that gets split, in the order of its first row, the other rows stay as they are
+        LeafTriangles rows = std::move(leafTriangles);
+        leafTriangles = {};
+        std::vector<OctreeNode*> splits;
+        std::vector<std::vector<int>> splitTriangles;
+        std::unordered_map<OctreeNode*, std::size_t> splitIndex;
+        for (std::size_t i = 0; i < rows.leaves.size(); i++)
+        {
+            OctreeNode* leaf = rows.leaves[i];
+            std::span<int const> triangles{ rows.triangles.data() + rows.offsets[i], rows.triangles.data() + rows.offsets[i + 1] };
+            if (static_cast<int>(leaf->layer) >= layer)
+            {
+                leafTriangles.add(leaf, triangles);
+                continue;
+            }
+            auto [it, inserted] = splitIndex.try_emplace(leaf, splits.size());
+            if (inserted)
+            {
+                splits.push_back(leaf);
+                splitTriangles.emplace_back();
+            }
+            splitTriangles[it->second].insert(splitTriangles[it->second].end(), triangles.begin(), triangles.end());
+        }
+        rows = {};
+
+        TriangleBatch batch{ keptVertices, keptIndices };
+        std::vector<std::array<std::vector<int>, 8>> lists(layer + 1);
+        // The split leaves and the new moveable leaves lose or gain edges, and so do the neighbors of both
+        std::vector<OctreeNode*> changed;
+        std::vector<OctreeNode*> split;
+        std::vector<OctreeNode*> toLink;
+        for (std::size_t s = 0; s < splits.size(); s++)
+        {
+            OctreeNode* leaf = splits[s];
+            std::vector<int> triangles = std::move(splitTriangles[s]);
+            // A collapsed leaf has the rows of all the leaves it was made of, which share triangles
+            std::sort(triangles.begin(), triangles.end());
+            triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+            if (not canRefine(leaf))
+            {
+                leafTriangles.add(leaf, triangles);
+                continue;
+            }
+            if (updatePathGraph)
+            {
+                NodeRef leafRef = translate(leaf);
+                for (NodeRef i : pathGraphEdgeArray(leaf).view())
+                {
+                    pathGraphEdgeArray(resolve(i)).remove(leafRef);
+                    toLink.push_back(resolve(i));
+                }
+                pathGraphEdgeArray(leaf) = {};
+                split.push_back(leaf);
+            }
+            std::size_t firstLeaf = leafTriangles.leaves.size();
+            leaf->isMoveable = false;
+            leaf->addTerrainTriangleList(*this, nodeAllocator, batch, triangles, layer, lists, &leafTriangles);
+            toLink.insert(toLink.end(), leafTriangles.leaves.begin() + firstLeaf, leafTriangles.leaves.end());
+        }
+        if (not updatePathGraph)
+        {
+            return;
+        }
+
+        // The links calculateTerrainPathGraph finds from these nodes, every link has an edge at both ends
+        for (OctreeNode* q : toLink)
+        {
+            changed.push_back(q);
+            if (not q->isMoveable or q->layer == 0)
+            {
+                continue;
+            }
+            NodeRef qRef = translate(q);
+            for (int direction = 0; direction < 6; direction++)
+            {
+                OctreeNode* found = findAdjacentNode(q, direction);
+                if (found == nullptr or not found->isMoveable)
+                {
+                    continue;
+                }
+                if (found->layer < q->layer or found->children == NodeRef{})
+                {
+                    NodeRef foundRef = translate(found);
+                    auto qEdges = pathGraphEdgeArray(q).view();
+                    if (std::find(qEdges.begin(), qEdges.end(), foundRef) == qEdges.end())
+                    {
+                        pathGraphEdgeArray(q).add(foundRef);
+                        pathGraphEdgeArray(found).add(qRef);
+                        changed.push_back(found);
+                    }
+                }
+            }
+        }
+        // Relabeling piece by piece only pays off for a small part of the path graph, refining all leaves changes all of it
+        if (changed.size() < static_cast<std::size_t>(graph->nodesNumber) / 4)
+        {
+            changed.insert(changed.end(), split.begin(), split.end());
+            updateComponents(std::move(changed));
+        }
+        else
+        {
+            for (OctreeNode* leaf : split)
+            {
+                setComponentIndex(leaf, OctreeNode::invalidComponentIndex);
+            }
+            updateSCC();
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    typename Octree<Allocator, NodeLayout>::OctreeNode* Octree<Allocator, NodeLayout>::positionToNode(Vector3 const& position)
+    {
+        OctreeNode* node = root;
+        while (node->children and node->runtimeMoveableCounter == 0)
+        {
+            Vector3 diff = position - node->center(*this);
+            unsigned offset = 4U * (diff.x <= 0) + 2U * (diff.y <= 0) + (diff.z <= 0);
+            node = resolve(node->children + offset);
+        }
+        return node;
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    bool Octree<Allocator, NodeLayout>::lineOfSight(Vector3 const& from, Vector3 const& to)
+    {
+        float length = (from - to).length();
+        Vector3 direction = (from - to) / length;
+        float constexpr fLowest = std::numeric_limits<float>::lowest();
+        float constexpr fMax = std::numeric_limits<float>::max();
+        // prevent nan in intersectWithRayBox
+        float invDirX = std::clamp(1.f / direction.x, fLowest, fMax);
+        float invDirY = std::clamp(1.f / direction.y, fLowest, fMax);
+        float invDirZ = std::clamp(1.f / direction.z, fLowest, fMax);
+
+        struct Stack : std::stack<NodeRef, std::vector<NodeRef>>
+        {
+            Stack()
+            {
+                this->c.reserve(256);
+            }
+        };
+        Stack workList{};
+        workList.push(translate(root));
+        while (workList.size() != 0)
+        {
+            OctreeNode* node = resolve(workList.top());
+            workList.pop();
+            if (!node->isContainsMoveableChildren && !node->isContainsRuntimeMoveableChildren)
+            {
+                continue;
+            }
+            // Due to some strange reason, " * 1.01" can eliminate "false positive"
+            Vector3 constexpr oneWithEpsilon = Vector3{ .x = 1.01f, .y = 1.01f, .z = 1.01f };
+            Vector3 enlargedSize = oneWithEpsilon * node->size(*this);
+            Vector3 centerPosition = node->center(*this);
+            if (intersectRayBox(centerPosition - enlargedSize, centerPosition + enlargedSize, to, invDirX, invDirY, invDirZ, length))
+            {
+                if (node->children != NodeRef{})
+                {
+                    workList.push(node->children + 0);
+                    workList.push(node->children + 1);
+                    workList.push(node->children + 2);
+                    workList.push(node->children + 3);
+                    workList.push(node->children + 4);
+                    workList.push(node->children + 5);
+                    workList.push(node->children + 6);
+                    workList.push(node->children + 7);
+                }
+                else
+                {
+                    if (node->isMoveable || node->runtimeMoveableCounter != 0)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // 0 = +x, 1 = -x, 2 = +y, 3 = -y, 4 = +z, 5 = -z
+    template<typename Allocator, typename NodeLayout>
+    typename Octree<Allocator, NodeLayout>::OctreeNode* Octree<Allocator, NodeLayout>::findAdjacentNode(OctreeNode* node, int directionIndex)
+    {
+        int x = node->worldIndex0 + adjacentDirections[directionIndex][0];
+        int y = node->worldIndex1 + adjacentDirections[directionIndex][1];
+        int z = node->worldIndex2 + adjacentDirections[directionIndex][2];
+        int cells = 1 << node->layer;
+        if (x < 0 or y < 0 or z < 0 or x >= cells or y >= cells or z >= cells)
+        {
+            return nullptr;
+        }
+        if constexpr (hasCompactNodes)
+        {
+            // Without parent links the neighboring cell is found from the root
+            return findAdjacentNodeBelow(node, directionIndex, root);
+        }
+        else
+        {
+            // The world indices are the locational code of a node. Both cells share their ancestors above the highest differing bit,
+            // so the walk from the root would pass through the ancestor of node that many layers up. Start there instead,
+            // which is one or two layers for most neighbors.
+            int up = std::bit_width(static_cast<unsigned int>((x ^ node->worldIndex0) | (y ^ node->worldIndex1) | (z ^ node->worldIndex2)));
+            OctreeNode* current = node;
+            for (int i = 0; i < up; i++)
+            {
+                current = resolve(current->parent);
+            }
+            return findAdjacentNodeBelow(node, directionIndex, current);
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    typename Octree<Allocator, NodeLayout>::OctreeNode* Octree<Allocator, NodeLayout>::findAdjacentNodeBelow(OctreeNode* node, int directionIndex,
+        OctreeNode* start)
+    {
+        if (start == nullptr)
+        {
+            return nullptr;
+        }
+        int x = node->worldIndex0 + adjacentDirections[directionIndex][0];
+        int y = node->worldIndex1 + adjacentDirections[directionIndex][1];
+        int z = node->worldIndex2 + adjacentDirections[directionIndex][2];
+        OctreeNode* current = start;
+        for (int shift = node->layer - start->layer - 1; shift >= 0; shift--)
+        {
+            OctreeNode* childrenbase = resolve(current->children);
+            if (childrenbase == nullptr)
+            {
+                return current;
+            }
+            current = childrenbase + (4 * ((x >> shift) & 1) + 2 * ((y >> shift) & 1) + ((z >> shift) & 1));
+        }
+        return current;
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    template<typename Body>
+    void Octree<Allocator, NodeLayout>::forEachChunk(ThreadPool* pool, std::size_t count, Body&& body)
+    {
+        std::size_t chunkCount = 1;
+        if (pool != nullptr && pool->size() > 1)
+        {
+            chunkCount = std::max<std::size_t>(std::min<std::size_t>(pool->size() * 4, count / 4096), 1);
+        }
+        if (chunkCount == 1)
+        {
+            body(std::size_t{ 0 }, count);
+            return;
+        }
+        TaskGroup group{ *pool };
+        for (std::size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            group.run([&, chunk] { body(chunk * count / chunkCount, (chunk + 1) * count / chunkCount); });
+        }
+        group.wait();
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    template<typename Visit>
+    void Octree<Allocator, NodeLayout>::forEachLeafWithNeighbors(ThreadPool* pool, Visit&& visit)
+    {
+        struct Pending
+        {
+            OctreeNode* node;
+            std::array<NodeRef, 6> neighbors;
+        };
+        // Appends the children of a node with their neighbors
+        auto expand = [this](Pending const& pending, std::vector<Pending>& result)
+        {
+            // The children are allocated together, so the handle of a sibling is an offset from the first one
+            NodeRef children = pending.node->children;
+            OctreeNode* childrenBase = resolve(children);
+            for (int r = 7; r >= 0; r--)
+            {
+                Pending& child = result.emplace_back(Pending{ childrenBase + r, {} });
+                for (int i = 0; i < 6; i++)
+                {
+                    // The child bit along the direction's axis, 4 for x, 2 for y and 1 for z
+                    int axisBit = 4 >> (i / 2);
+                    bool towardsSibling = adjacentDirections[i][i / 2] > 0 ? (r & axisBit) == 0 : (r & axisBit) != 0;
+                    child.neighbors[i] = towardsSibling ? children + (r ^ axisBit) : pending.neighbors[i];
+                }
+            }
+        };
+        auto walk = [&](Pending const& subtree)
+        {
+            std::vector<Pending> stack{ subtree };
+            while (not stack.empty())
+            {
+                Pending pending = stack.back();
+                stack.pop_back();
+                if (pending.node->children == NodeRef{})
+                {
+                    visit(pending.node, pending.neighbors);
+                }
+                else
+                {
+                    expand(pending, stack);
+                }
+            }
+        };
+
+        // Split the tree layer by layer until there are enough subtrees to keep the pool busy
+        std::vector<Pending> subtrees{ Pending{ root, {} } };
+        std::size_t wanted = pool != nullptr && pool->size() > 1 ? pool->size() * 16 : 1;
+        while (subtrees.size() < wanted)
+        {
+            std::vector<Pending> next;
+            for (Pending const& pending : subtrees)
+            {
+                if (pending.node->children == NodeRef{})
+                {
+                    next.push_back(pending);
+                }
+                else
+                {
+                    expand(pending, next);
+                }
+            }
+            if (next.size() == subtrees.size())
+            {
+                break;
+            }
+            subtrees = std::move(next);
+        }
+        if (subtrees.size() == 1)
+        {
+            walk(subtrees.front());
+            return;
+        }
+        TaskGroup group{ *pool };
+        for (Pending const& subtree : subtrees)
+        {
+            group.run([&walk, &subtree] { walk(subtree); });
+        }
+        group.wait();
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::updateSCC(ThreadPool* pool)
+    {
+        // The frozen path graph already numbers the leaves
+        std::vector<OctreeNode*> collectedLeaves;
+        if (not isPathGraphFrozen)
+        {
+            collectedLeaves.reserve(numberOfNodes);
+            root->leaves(*this, collectedLeaves);
+        }
+        std::vector<OctreeNode*> const& leaves = isPathGraphFrozen ? frozenPathGraph.leaves : collectedLeaves;
+        std::size_t leafCount = leaves.size();
+        prepareCompactNodeData();
+
+        // Union find over the leaf numbers. A set is always rooted at its smallest leaf number and
+        // parents only ever decrease, so unions and path halving can race on the pool without locks.
+        std::vector<std::atomic<unsigned int>> parents(leafCount);
+        auto find = [&](unsigned int i)
+        {
+            unsigned int parent = parents[i].load(std::memory_order_relaxed);
+            while (parent != i)
+            {
+                unsigned int grandparent = parents[parent].load(std::memory_order_relaxed);
+                if (grandparent != parent)
+                {
+                    parents[i].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+                }
+                i = grandparent;
+                parent = parents[i].load(std::memory_order_relaxed);
+            }
+            return i;
+        };
+        forEachChunk(pool, leafCount, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                setLeafIndex(leaves[i], static_cast<unsigned int>(i));
+                parents[i].store(static_cast<unsigned int>(i), std::memory_order_relaxed);
+            }
+        });
+        forEachChunk(pool, leafCount, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                for (NodeRef toRef : pathGraphEdgesOf(leaves[i]))
+                {
+                    unsigned int a = static_cast<unsigned int>(i);
+                    unsigned int b = leafIndexOf(resolve(toRef));
+                    while (true)
+                    {
+                        a = find(a);
+                        b = find(b);
+                        if (a == b)
+                        {
+                            break;
+                        }
+                        if (a < b)
+                        {
+                            std::swap(a, b);
+                        }
+                        // Fails if another thread linked a in the meantime, then try again from the new roots
+                        unsigned int expected = a;
+                        if (parents[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+                        {
+                            break;
+                        }
+                    }
+                }
+            }
+        });
+
+        // Number the components in leaf order, the root of a leaf always comes before the leaf
+        components.clear();
+        emptyComponents.clear();
+        std::vector<std::size_t> componentSizes;
+        int nodesNumber = 0;
+        for (std::size_t i = 0; i < leafCount; i++)
+        {
+            OctreeNode* q = leaves[i];
+            if (pathGraphEdgesOf(q).empty())
+            {
+                setComponentIndex(q, OctreeNode::invalidComponentIndex);
+                continue;
+            }
+            nodesNumber++;
+            unsigned int root = find(static_cast<unsigned int>(i));
+            if (root == i)
+            {
+                componentSizes.push_back(0);
+                setComponentIndex(q, static_cast<unsigned int>(componentSizes.size()));
+            }
+            else
+            {
+                setComponentIndex(q, componentIndexOf(leaves[root]));
+            }
+            componentSizes[componentIndexOf(q) - 1]++;
+        }
+        components.resize(componentSizes.size());
+        for (std::size_t i = 0; i < componentSizes.size(); i++)
+        {
+            components[i].reserve(componentSizes[i]);
+        }
+        for (OctreeNode* q : leaves)
+        {
+            if (componentIndexOf(q) != OctreeNode::invalidComponentIndex)
+            {
+                attachToComponent(q, componentIndexOf(q));
+            }
+        }
+        updateLargestComponent();
+        graph->nodesNumber = nodesNumber;
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::updateComponents(std::vector<OctreeNode*> changed)
+    {
+        // Independent of the node addresses, so new components get the same numbers in every run
+        auto key = [](OctreeNode* node)
+        {
+            return (std::uint64_t{ node->layer } << 51) | (std::uint64_t{ node->worldIndex0 } << 34)
+                | (std::uint64_t{ node->worldIndex1 } << 17) | node->worldIndex2;
+        };
+        std::sort(changed.begin(), changed.end(), [&](OctreeNode* a, OctreeNode* b) { return key(a) < key(b); });
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+        std::set<unsigned int> affected;
+        for (OctreeNode* node : changed)
+        {
+            if (componentIndexOf(node) != OctreeNode::invalidComponentIndex)
+            {
+                affected.insert(componentIndexOf(node));
+                detachFromComponent(node);
+            }
+        }
+
+        // Every piece of an affected component is next to a changed node that is still in the path graph.
+        // Search from all of them at once, one node per search and round, and join searches that meet.
+        // A group of searches that runs dry has found a whole component. Once a single group is left running,
+        // it is the component everything else of the affected components belongs to, without searching it all.
+        struct Search
+        {
+            std::vector<OctreeNode*> nodes;
+            std::size_t next = 0;
+        };
+        std::vector<Search> searches;
+        std::vector<int> groups;  // union find over the searches, rooted at the first search of a group
+        std::vector<int> running;  // per group root, searches of the group that have not run dry
+        std::unordered_map<OctreeNode*, int> visitedBy;
+        for (OctreeNode* node : changed)
+        {
+            if (pathGraphEdgeArray(node).valid() && visitedBy.emplace(node, static_cast<int>(searches.size())).second)
+            {
+                groups.push_back(static_cast<int>(searches.size()));
+                running.push_back(1);
+                searches.push_back(Search{ .nodes = { node } });
+            }
+        }
+        auto findGroup = [&](int search)
+        {
+            while (groups[search] != search)
+            {
+                search = groups[search] = groups[groups[search]];
+            }
+            return search;
+        };
+        std::size_t runningGroups = searches.size();
+        std::vector<int> active(searches.size());
+        std::iota(active.begin(), active.end(), 0);
+        while (runningGroups > 1)
+        {
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < active.size(); i++)
+            {
+                int s = active[i];
+                Search& search = searches[s];
+                OctreeNode* node = search.nodes[search.next++];
+                for (NodeRef toRef : pathGraphEdgeArray(node).view())
+                {
+                    OctreeNode* to = resolve(toRef);
+                    auto [visited, inserted] = visitedBy.emplace(to, s);
+                    if (inserted)
+                    {
+                        search.nodes.push_back(to);
+                        continue;
+                    }
+                    int group = findGroup(s);
+                    int other = findGroup(visited->second);
+                    if (group != other)
+                    {
+                        // Both groups are still running, no edge leaves a group that ran dry
+                        runningGroups--;
+                        groups[std::max(group, other)] = std::min(group, other);
+                        running[std::min(group, other)] += running[std::max(group, other)];
+                    }
+                }
+                if (search.next < search.nodes.size())
+                {
+                    active[kept++] = s;
+                }
+                else if (--running[findGroup(s)] == 0)
+                {
+                    runningGroups--;
+                }
+            }
+            active.resize(kept);
+        }
+        std::vector<std::vector<int>> members(searches.size());
+        for (int s = 0; s < static_cast<int>(searches.size()); s++)
+        {
+            members[findGroup(s)].push_back(s);
+        }
+        auto groupNodes = [&](int group, auto&& visit)
+        {
+            for (int s : members[group])
+            {
+                for (OctreeNode* node : searches[s].nodes)
+                {
+                    visit(node);
+                }
+            }
+        };
+        auto moveGroup = [&](int group, unsigned int index)
+        {
+            groupNodes(group, [&](OctreeNode* node)
+            {
+                if (componentIndexOf(node) != index)
+                {
+                    detachFromComponent(node);
+                    attachToComponent(node, index);
+                }
+            });
+        };
+
+        // Groups that ran dry keep the number of a component they contain completely, or get a new one
+        int remaining = -1;
+        for (int group = 0; group < static_cast<int>(searches.size()); group++)
+        {
+            if (members[group].empty())
+            {
+                continue;
+            }
+            if (running[group] != 0)
+            {
+                remaining = group;
+                continue;
+            }
+            std::map<unsigned int, std::size_t> counts;
+            groupNodes(group, [&](OctreeNode* node)
+            {
+                if (componentIndexOf(node) != OctreeNode::invalidComponentIndex)
+                {
+                    counts[componentIndexOf(node)]++;
+                }
+            });
+            unsigned int index = OctreeNode::invalidComponentIndex;
+            for (auto [label, count] : counts)
+            {
+                if (count == components[label - 1].size() && (index == OctreeNode::invalidComponentIndex || count > components[index - 1].size()))
+                {
+                    index = label;
+                }
+            }
+            if (index != OctreeNode::invalidComponentIndex)
+            {
+                affected.erase(index);
+            }
+            moveGroup(group, index != OctreeNode::invalidComponentIndex ? index : makeComponent());
+        }
+
+        // The group still running joins whatever is left of the affected components, into the largest of them
+        if (remaining >= 0)
+        {
+            unsigned int index = OctreeNode::invalidComponentIndex;
+            for (unsigned int label : affected)
+            {
+                if (not components[label - 1].empty() && (index == OctreeNode::invalidComponentIndex || components[label - 1].size() > components[index - 1].size()))
+                {
+                    index = label;
+                }
+            }
+            if (index == OctreeNode::invalidComponentIndex)
+            {
+                index = makeComponent();
+            }
+            for (unsigned int label : affected)
+            {
+                while (label != index && not components[label - 1].empty())
+                {
+                    OctreeNode* node = components[label - 1].back();
+                    detachFromComponent(node);
+                    attachToComponent(node, index);
+                }
+            }
+            moveGroup(remaining, index);
+        }
+
+        for (unsigned int label : affected)
+        {
+            if (components[label - 1].empty())
+            {
+                emptyComponents.insert(label);
+            }
+        }
+        while (not components.empty() && components.back().empty())
+        {
+            emptyComponents.erase(static_cast<unsigned int>(components.size()));
+            components.pop_back();
+        }
+        updateLargestComponent();
+        graph->nodesNumber = 0;
+        for (auto const& nodes : components)
+        {
+            graph->nodesNumber += static_cast<int>(nodes.size());
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    unsigned int Octree<Allocator, NodeLayout>::makeComponent()
+    {
+        if (not emptyComponents.empty())
+        {
+            unsigned int index = *emptyComponents.begin();
+            emptyComponents.erase(emptyComponents.begin());
+            return index;
+        }
+        components.emplace_back();
+        return static_cast<unsigned int>(components.size());
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::attachToComponent(OctreeNode* node, unsigned int index)
+    {
+        std::vector<OctreeNode*>& nodes = components[index - 1];
+        setComponentIndex(node, index);
+        setComponentPosition(node, static_cast<unsigned int>(nodes.size()));
+        nodes.push_back(node);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::detachFromComponent(OctreeNode* node)
+    {
+        if (componentIndexOf(node) == OctreeNode::invalidComponentIndex)
+        {
+            return;
+        }
+        std::vector<OctreeNode*>& nodes = components[componentIndexOf(node) - 1];
+        OctreeNode* last = nodes.back();
+        nodes[componentPositionOf(node)] = last;
+        setComponentPosition(last, componentPositionOf(node));
+        nodes.pop_back();
+        setComponentIndex(node, OctreeNode::invalidComponentIndex);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::updateLargestComponent()
+    {
+        largestComponent = 0;
+        for (std::size_t i = 0; i < components.size(); i++)
+        {
+            if (not components[i].empty() && (largestComponent == 0 || components[i].size() > components[largestComponent - 1].size()))
+            {
+                largestComponent = static_cast<int>(i + 1);
+            }
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    int Octree<Allocator, NodeLayout>::componentCount() const
+    {
+        return static_cast<int>(components.size());
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    std::span<typename Octree<Allocator, NodeLayout>::OctreeNode* const> Octree<Allocator, NodeLayout>::componentView(int index) const
+    {
+        if (index <= 0 || index > componentCount())
+        {
+            return {};
+        }
+        return components[index - 1];
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::calculateTerrainPathGraph(ThreadPool* pool)
+    {
+        FrozenPathGraph& frozen = frozenPathGraph;
+        isPathGraphFrozen = false;
+        frozen.leaves.clear();
+        root->leaves(*this, frozen.leaves);
+        std::size_t leafCount = frozen.leaves.size();
+        // A leaf that got split after it had edges keeps them, but they are never read again.
+        // Drop them with the others, the frozen path graph holds every edge.
+        if constexpr (hasCompactNodes)
+        {
+            compactNodeData.edges.clear();
+        }
+        else
+        {
+            std::vector<OctreeNode*> stack{ root };
+            while (not stack.empty())
+            {
+                OctreeNode* node = stack.back();
+                stack.pop_back();
+                node->pathGraphEdges = {};
+                OctreeNode* children = resolve(node->children);
+                for (int r = 0; r < 8 and children != nullptr; r++)
+                {
+                    if (children[r].children != NodeRef{})
+                    {
+                        stack.push_back(children + r);
+                    }
+                }
+            }
+        }
+        prepareCompactNodeData();
+        forEachChunk(pool, leafCount, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                pathGraphEdgeArray(frozen.leaves[i]) = {};
+                setLeafIndex(frozen.leaves[i], static_cast<unsigned int>(i));
+            }
+        });
+
+        // The neighbor every moveable leaf links to in every direction
+        std::uint32_t constexpr noNeighbor = std::numeric_limits<std::uint32_t>::max();
+        std::vector<std::uint32_t> neighbors(leafCount * 6, noNeighbor);
+        std::vector<std::atomic<std::uint32_t>> degrees(leafCount);
+        forEachLeafWithNeighbors(pool, [&](OctreeNode* q, std::array<NodeRef, 6> const& starts)
+        {
+            if (not q->isMoveable || q->layer == 0)
+            {
+                return;
+            }
+            std::size_t i = leafIndexOf(q);
+            for (int direction = 0; direction < 6; direction++)
+            {
+                OctreeNode* found = findAdjacentNodeBelow(q, direction, resolve(starts[direction]));
+                if (found == nullptr || !found->isMoveable)
+                {
+                    continue;
+                }
+                if (found->layer < q->layer || found->children == NodeRef{})
+                {
+                    neighbors[i * 6 + direction] = leafIndexOf(found);
+                    degrees[i].fetch_add(1, std::memory_order_relaxed);
+                    degrees[leafIndexOf(found)].fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+
+        // Both ends of every link get an edge, remembering which leaf and direction found it.
+        // Edges found twice are removed and every row is put in the order in which the leaves found its edges,
+        // which is the order adding them leaf by leaf to the nodes would have produced.
+        struct Candidate
+        {
+            std::uint32_t to;
+            std::uint64_t foundBy;
+        };
+        std::vector<std::size_t> candidateOffsets(leafCount + 1, 0);
+        for (std::size_t i = 0; i < leafCount; i++)
+        {
+            candidateOffsets[i + 1] = candidateOffsets[i] + degrees[i].load(std::memory_order_relaxed);
+            degrees[i].store(0, std::memory_order_relaxed);
+        }
+        std::vector<Candidate> candidates(candidateOffsets.back());
+        forEachChunk(pool, leafCount, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                for (int direction = 0; direction < 6; direction++)
+                {
+                    std::uint32_t found = neighbors[i * 6 + direction];
+                    if (found != noNeighbor)
+                    {
+                        std::uint64_t foundBy = i * 6 + direction;
+                        candidates[candidateOffsets[i] + degrees[i].fetch_add(1, std::memory_order_relaxed)] =
+                            Candidate{ .to = found, .foundBy = foundBy };
+                        candidates[candidateOffsets[found] + degrees[found].fetch_add(1, std::memory_order_relaxed)] =
+                            Candidate{ .to = static_cast<std::uint32_t>(i), .foundBy = foundBy };
+                    }
+                }
+            }
+        });
+        forEachChunk(pool, leafCount, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                auto rowBegin = candidates.begin() + candidateOffsets[i];
+                auto rowEnd = candidates.begin() + candidateOffsets[i + 1];
+                std::sort(rowBegin, rowEnd, [](Candidate const& a, Candidate const& b)
+                {
+                    return a.to != b.to ? a.to < b.to : a.foundBy < b.foundBy;
+                });
+                rowEnd = std::unique(rowBegin, rowEnd, [](Candidate const& a, Candidate const& b) { return a.to == b.to; });
+                std::sort(rowBegin, rowEnd, [](Candidate const& a, Candidate const& b) { return a.foundBy < b.foundBy; });
+                degrees[i].store(static_cast<std::uint32_t>(rowEnd - rowBegin), std::memory_order_relaxed);
+            }
+        });
+
+        frozen.offsets.assign(leafCount + 1, 0);
+        for (std::size_t i = 0; i < leafCount; i++)
+        {
+            frozen.offsets[i + 1] = frozen.offsets[i] + degrees[i].load(std::memory_order_relaxed);
+        }
+        frozen.targets.resize(frozen.offsets.back());
+        forEachChunk(pool, leafCount, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                for (std::uint32_t k = 0; k < frozen.offsets[i + 1] - frozen.offsets[i]; k++)
+                {
+                    frozen.targets[frozen.offsets[i] + k] = translate(frozen.leaves[candidates[candidateOffsets[i] + k].to]);
+                }
+            }
+        });
+        isPathGraphFrozen = true;
+        updateSCC(pool);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    std::span<typename Octree<Allocator, NodeLayout>::NodeRef const> Octree<Allocator, NodeLayout>::pathGraphEdgesOf(OctreeNode const* node) const
+    {
+        if (not isPathGraphFrozen)
+        {
+            if constexpr (hasCompactNodes)
+            {
+                auto const& edges = compactNodeData.edges;
+                return node->row < edges.size() ? edges[node->row].view() : std::span<NodeRef const>{};
+            }
+            else
+            {
+                return node->pathGraphEdges.view();
+            }
+        }
+        // Nodes that were not leaves when the path graph was frozen have no row
+        if (node->children != NodeRef{})
+        {
+            return {};
+        }
+        std::uint32_t const* offsets = frozenPathGraph.offsets.data() + leafIndexOf(node);
+        return { frozenPathGraph.targets.data() + offsets[0], frozenPathGraph.targets.data() + offsets[1] };
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::thawPathGraph()
+    {
+        if (not isPathGraphFrozen)
+        {
+            return;
+        }
+        isPathGraphFrozen = false;
+        FrozenPathGraph& frozen = frozenPathGraph;
+        prepareCompactNodeData();
+        for (std::size_t i = 0; i < frozen.leaves.size(); i++)
+        {
+            for (std::uint32_t k = frozen.offsets[i]; k < frozen.offsets[i + 1]; k++)
+            {
+                pathGraphEdgeArray(frozen.leaves[i]).add(frozen.targets[k]);
+            }
+        }
+        frozen = {};
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::calculateRuntimePathGraph()
+    {
+        thawPathGraph();
+        // Every node whose edges change, only their components need new labels
+        std::vector<OctreeNode*> changed;
+        for (auto q : toRecalculatePathGraph)
+        {
+            NodeRef qRef = translate(q);
+            changed.push_back(q);
+            for (auto i : pathGraphEdgeArray(q).view())
+            {
+                pathGraphEdgeArray(resolve(i)).remove(qRef);
+                changed.push_back(resolve(i));
+            }
+            pathGraphEdgeArray(q) = {};
+            if (!q->isMoveable && q->runtimeMoveableCounter == 0 && q->children == NodeRef{})
+            {
+                pathGraphEdgeArray(q) = {};
+            }
+        }
+        for (auto q : toRecalculatePathGraph)
+        {
+            if (!q->isMoveable && q->runtimeMoveableCounter == 0 && q->children == NodeRef{})
+            {
+                if (q->layer == 0)
+                {
+                    continue;
+                }
+                NodeRef nRef = translate(q);
+                for (int i = 0; i < 6; i++)
+                {
+                    auto found = findAdjacentNode(q, i);
+                    if (found == nullptr || found->isMoveable || found->runtimeMoveableCounter != 0) continue;
+                    if (found->layer < q->layer || found->children == NodeRef{})
+                    {
+                        auto qEdges = pathGraphEdgeArray(q).view();
+                        auto foundEdges = pathGraphEdgeArray(found).view();
+                        NodeRef nFoundRef = translate(found);
+
+                        if (qEdges.end() == std::find(qEdges.begin(), qEdges.end(), nFoundRef))
+                        {
+                            pathGraphEdgeArray(q).add(nFoundRef);
+                        }
+                        if (foundEdges.end() == std::find(foundEdges.begin(), foundEdges.end(), nRef))
+                        {
+                            pathGraphEdgeArray(found).add(nRef);
+                            changed.push_back(found);
+                        }
+                    }
+                }
+            }
+        }
+        toRecalculatePathGraph.clear();
+        updateComponents(std::move(changed));
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    int Octree<Allocator, NodeLayout>::samplePosition(Vector3 position, float radius, int scc, Vector3& result)
+    {
+        if (std::abs(position.x) > size || std::abs(position.y) > size || std::abs(position.z) > size)
         {
             result = position;
             return 0;
@@ -653,18 +1970,18 @@ namespace GraphGenerator
                 continue;
             }
             if (not node->isMoveable and node->runtimeMoveableCounter == 0
-                and node->pathGraphEdges.valid() and (node->pathGraphConnectComponentIndex == scc or scc <= 0))
+                and not pathGraphEdgesOf(node).empty() and (static_cast<int>(componentIndexOf(node)) == scc or scc <= 0))
             {
-                Vector3 diff = position - node->centerPosition;
+                Vector3 diff = position - node->center(*this);
                 float max = std::max(std::max(std::abs(diff.x), std::abs(diff.y)), std::abs(diff.z));
-                if (max > node->size())
+                if (max > node->size(*this))
                 {
-                    float scale = node->size() / max;
-                    result = node->centerPosition + diff * scale;
-                    return node->pathGraphConnectComponentIndex;
+                    float scale = node->size(*this) / max;
+                    result = node->center(*this) + diff * scale;
+                    return componentIndexOf(node);
                 }
                 result = position;
-                return node->pathGraphConnectComponentIndex;
+                return componentIndexOf(node);
             }
 
             for (int i = 0; i < 6; i++)
@@ -673,7 +1990,7 @@ namespace GraphGenerator
                 if (next != nullptr)
                 {
                     if (next != nullptr and testedNodes.find(next) == testedNodes.end()
-                        and (next->centerPosition - position).sqrLength() < radius * radius)
+                        and (next->center(*this) - position).sqrLength() < radius * radius)
                     {
                         worklist.push_back(next);
                     }
@@ -685,46 +2002,215 @@ namespace GraphGenerator
         return -1;
     }
 
-    template<typename Allocator>
-    typename Octree<Allocator>::OctreeNode* Octree<Allocator>::allocateNodes(std::size_t count)
+    template<typename Allocator, typename NodeLayout>
+    typename Octree<Allocator, NodeLayout>::OctreeNode* Octree<Allocator, NodeLayout>::allocateNodes(std::size_t count)
     {
-        return NodeAllocatorTraits::allocate(nodeAllocator, count);
+        return allocateNodes(nodeAllocator, count);
     }
 
-    template<typename Allocator>
-    void Octree<Allocator>::deallocateNodes(OctreeNode* memory, std::size_t count)
+    template<typename Allocator, typename NodeLayout>
+    typename Octree<Allocator, NodeLayout>::OctreeNode* Octree<Allocator, NodeLayout>::allocateNodes(NodeAllocator& allocator, std::size_t count)
+    {
+        return NodeAllocatorTraits::allocate(allocator, count);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::deallocateNodes(OctreeNode* memory, std::size_t count)
     {
         return NodeAllocatorTraits::deallocate(nodeAllocator, memory, count);
     }
 
-    template<typename Allocator>
-    void Octree<Allocator>::constructNode(OctreeNode* memory, int layer, OctreeNode* parent, int relativeX, int relativeY, int relativeZ)
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::constructNode(OctreeNode* memory, int layer, OctreeNode* parent, int relativeX, int relativeY, int relativeZ)
+    {
+        return constructNode(nodeAllocator, memory, layer, parent, relativeX, relativeY, relativeZ);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::constructNode(NodeAllocator& allocator, OctreeNode* memory, int layer, OctreeNode* parent,
+        int relativeX, int relativeY, int relativeZ)
     {
         ++numberOfNodes;
-        return NodeAllocatorTraits::construct(nodeAllocator, memory, index, layer, parent, relativeX, relativeY, relativeZ);
+        return NodeAllocatorTraits::construct(allocator, memory, *this, layer, parent, relativeX, relativeY, relativeZ);
     }
 
-    template<typename Allocator>
-    void Octree<Allocator>::destroyNode(OctreeNode* object)
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::destroyNode(OctreeNode* object)
     {
         --numberOfNodes;
+        object->destroyChildren(*this);
+        if constexpr (hasCompactNodes)
+        {
+            // The row is not reused, but its edges are freed with the node as they would be in a wide node
+            if (object->row < compactNodeData.edges.size())
+            {
+                compactNodeData.edges[object->row] = {};
+            }
+        }
         return NodeAllocatorTraits::destroy(nodeAllocator, object);
     }
 
-    template<typename Allocator>
-    typename Octree<Allocator>::NodeRef Octree<Allocator>::translate(OctreeNode* object)
+    template<typename Allocator, typename NodeLayout>
+    typename Octree<Allocator, NodeLayout>::NodeRef Octree<Allocator, NodeLayout>::translate(OctreeNode* object)
     {
         return NodeAllocatorTraits::translate(nodeAllocator, object);
     }
 
-    template<typename Allocator>
-    typename Octree<Allocator>::OctreeNode* Octree<Allocator>::resolve(NodeRef object)
+    template<typename Allocator, typename NodeLayout>
+    typename Octree<Allocator, NodeLayout>::OctreeNode* Octree<Allocator, NodeLayout>::resolve(NodeRef object)
     {
         return NodeAllocatorTraits::resolve(nodeAllocator, object);
     }
 
-    template<typename Allocator>
-    bool Octree<Allocator>::intersectRayBox
+    template<typename Allocator, typename NodeLayout>
+    typename Octree<Allocator, NodeLayout>::OctreeNode* Octree<Allocator, NodeLayout>::parentOf(OctreeNode* node)
+    {
+        if constexpr (hasCompactNodes)
+        {
+            if (node->layer == 0)
+            {
+                return nullptr;
+            }
+            // Descend along the cell of the node, the bits of worldIndex below the parent's layer pick the children
+            OctreeNode* current = root;
+            for (int shift = node->layer - 1; shift > 0; shift--)
+            {
+                current = resolve(current->children) + (4 * ((node->worldIndex0 >> shift) & 1) + 2 * ((node->worldIndex1 >> shift) & 1) +
+                    ((node->worldIndex2 >> shift) & 1));
+            }
+            return current;
+        }
+        else
+        {
+            return resolve(node->parent);
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    unsigned int Octree<Allocator, NodeLayout>::componentIndexOf(OctreeNode const* node) const
+    {
+        if constexpr (hasCompactNodes)
+        {
+            auto const& values = compactNodeData.componentIndex;
+            return node->row < values.size() ? values[node->row] : OctreeNode::invalidComponentIndex;
+        }
+        else
+        {
+            return node->pathGraphConnectComponentIndex;
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::setComponentIndex(OctreeNode* node, unsigned int index)
+    {
+        if constexpr (hasCompactNodes)
+        {
+            if (node->row >= compactNodeData.componentIndex.size())
+            {
+                prepareCompactNodeData();
+            }
+            compactNodeData.componentIndex[node->row] = index;
+        }
+        else
+        {
+            node->pathGraphConnectComponentIndex = index;
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    unsigned int Octree<Allocator, NodeLayout>::componentPositionOf(OctreeNode const* node) const
+    {
+        if constexpr (hasCompactNodes)
+        {
+            auto const& values = compactNodeData.componentPosition;
+            return node->row < values.size() ? values[node->row] : 0;
+        }
+        else
+        {
+            return node->pathGraphComponentPosition;
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::setComponentPosition(OctreeNode* node, unsigned int position)
+    {
+        if constexpr (hasCompactNodes)
+        {
+            if (node->row >= compactNodeData.componentPosition.size())
+            {
+                prepareCompactNodeData();
+            }
+            compactNodeData.componentPosition[node->row] = position;
+        }
+        else
+        {
+            node->pathGraphComponentPosition = position;
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    unsigned int Octree<Allocator, NodeLayout>::leafIndexOf(OctreeNode const* node) const
+    {
+        if constexpr (hasCompactNodes)
+        {
+            auto const& values = compactNodeData.leafIndex;
+            return node->row < values.size() ? values[node->row] : 0;
+        }
+        else
+        {
+            return node->pathGraphLeafIndex;
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::setLeafIndex(OctreeNode* node, unsigned int index)
+    {
+        if constexpr (hasCompactNodes)
+        {
+            if (node->row >= compactNodeData.leafIndex.size())
+            {
+                prepareCompactNodeData();
+            }
+            compactNodeData.leafIndex[node->row] = index;
+        }
+        else
+        {
+            node->pathGraphLeafIndex = index;
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    typename Octree<Allocator, NodeLayout>::PathGraphData& Octree<Allocator, NodeLayout>::pathGraphEdgeArray(OctreeNode* node)
+    {
+        if constexpr (hasCompactNodes)
+        {
+            if (node->row >= compactNodeData.edges.size())
+            {
+                prepareCompactNodeData();
+            }
+            return compactNodeData.edges[node->row];
+        }
+        else
+        {
+            return node->pathGraphEdges;
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::prepareCompactNodeData()
+    {
+        if constexpr (hasCompactNodes)
+        {
+            std::size_t rows = compactNodeRows.load(std::memory_order_relaxed);
+            compactNodeData.componentIndex.resize(rows, OctreeNode::invalidComponentIndex);
+            compactNodeData.componentPosition.resize(rows, 0);
+            compactNodeData.leafIndex.resize(rows, 0);
+            compactNodeData.edges.resize(rows);
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    bool Octree<Allocator, NodeLayout>::intersectRayBox
     (
         Vector3 const& min, Vector3 const& max, Vector3 const& origin,
         float invDirX, float invDirY, float invDirZ, float length
@@ -753,29 +2239,317 @@ namespace GraphGenerator
         return not (far < 0 or near >= length or near > far);
     }
 
-    template<typename Allocator>
-    typename Octree<Allocator>::OctreeNode* Octree<Allocator>::findAdjacentNode(int x, int y, int z, int layer)
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::buildTerrainSubtree(OctreeNode* node, NodeAllocator& allocator, TriangleBatch const& batch,
+        std::span<int const> candidates, int maxLayer)
     {
-        int t = 1 << layer;
-        if (x >= t || x < 0 || y >= t || y < 0 || z >= t || z < 0)
+        if (candidates.empty())
         {
-            return nullptr;
+            return;
         }
-        OctreeNode* current = root;
-        for (int l = 0; l < layer; l++)
+        std::vector<std::array<std::vector<int>, 8>> lists(std::max<int>(maxLayer, node->layer) + 1);
+        std::vector<int>& triangles = lists[node->layer][0];
+        if (not node->isMoveable)
         {
-            t >>= 1;
-            OctreeNode* childrenbase = resolve(current->children);
-            if (childrenbase == nullptr)
+            appendTrianglesOverlappingBox(node->center(*this), node->size(*this), batch.vertices, batch.indices, candidates, triangles);
+            if (triangles.empty())
             {
-                return current;
+                return;
             }
-            current = childrenbase + (4 * (x / t) + 2 * (y / t) + (z / t));
-            x %= t;
-            y %= t;
-            z %= t;
         }
-        return current;
+        node->addTerrainTriangleList(*this, allocator, batch, triangles, maxLayer, lists);
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    bool Octree<Allocator, NodeLayout>::buildTerrainSubtreesInParallel(TriangleBatch const& batch, int maxLayer, ThreadPool& pool)
+    {
+        // Above the frontier layer, a triangle reaches a node exactly when it intersects the node's ancestors,
+        // as long as none of them is moveable. So triangles can be routed to the frontier nodes independently,
+        // after which every frontier subtree is built from its triangles, kept in their original order.
+        int frontierLayer = std::min(parallelBuildLayer, maxLayer - 1);
+        if (pool.size() < 2 || frontierLayer < 1)
+        {
+            return false;
+        }
+        // Nodes down to the frontier, layer by layer, (x * n + y) * n + z inside a layer of n^3 nodes
+        std::vector<int> layerOffsets{ 0 };
+        for (int layer = 0; layer <= frontierLayer; layer++)
+        {
+            layerOffsets.push_back(layerOffsets.back() + (1 << (3 * layer)));
+        }
+        auto nodeIndex = [&](int layer, int x, int y, int z)
+        {
+            int n = 1 << layer;
+            return layerOffsets[layer] + (x * n + y) * n + z;
+        };
+        int frontierOffset = layerOffsets[frontierLayer];
+        int frontierCount = layerOffsets[frontierLayer + 1] - frontierOffset;
+
+        // Same arithmetic as the OctreeNode constructor, so the intersection tests match bit for bit
+        std::vector<Vector3> centers(layerOffsets.back());
+        std::vector<OctreeNode*> nodes(layerOffsets.back(), nullptr);
+        centers[0] = root->center(*this);
+        nodes[0] = root;
+        auto visitChildren = [&](int layer, int x, int y, int z, auto&& visit)
+        {
+            for (int r = 0; r < 8; r++)
+            {
+                visit(r, nodeIndex(layer + 1, x * 2 + (r >> 2), y * 2 + ((r >> 1) & 1), z * 2 + (r & 1)));
+            }
+        };
+        for (int layer = 0; layer < frontierLayer; layer++)
+        {
+            int n = 1 << layer;
+            for (int x = 0; x < n; x++) for (int y = 0; y < n; y++) for (int z = 0; z < n; z++)
+            {
+                int index = nodeIndex(layer, x, y, z);
+                OctreeNode* node = nodes[index];
+                if (node != nullptr && node->isMoveable)
+                {
+                    return false;
+                }
+                visitChildren(layer, x, y, z, [&](int r, int child)
+                {
+                    centers[child] = centers[index] + (size / (1 << (layer + 1))) * OctreeNode::cornerDirections[r >> 2][(r >> 1) & 1][r & 1];
+                    OctreeNode* childrenBase = node != nullptr ? resolve(node->children) : nullptr;
+                    nodes[child] = childrenBase != nullptr ? childrenBase + r : nullptr;
+                });
+            }
+        }
+
+        // Route the triangles, every chunk keeps them in their original order
+        struct Partition
+        {
+            std::vector<std::vector<int>> triangles;  // per frontier node
+            std::vector<bool> touched;  // per node above the frontier
+        };
+        std::size_t triangleCount = batch.size();
+        std::size_t chunkCount = std::max<std::size_t>(std::min<std::size_t>(pool.size() * 4, triangleCount / 256), 1);
+        std::vector<Partition> partitions(chunkCount);
+        TaskGroup group{ pool };
+        for (std::size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            group.run([&, chunk]
+            {
+                Partition& partition = partitions[chunk];
+                partition.triangles.resize(frontierCount);
+                partition.touched.resize(frontierOffset);
+                for (std::size_t t = chunk * triangleCount / chunkCount; t < (chunk + 1) * triangleCount / chunkCount; t++)
+                {
+                    Vector3 const& point1 = batch.vertices[batch.indices[t * 3 + 0]];
+                    Vector3 const& point2 = batch.vertices[batch.indices[t * 3 + 1]];
+                    Vector3 const& point3 = batch.vertices[batch.indices[t * 3 + 2]];
+                    auto route = [&](auto&& self, int layer, int x, int y, int z) -> void
+                    {
+                        int index = nodeIndex(layer, x, y, z);
+                        if (layer == frontierLayer)
+                        {
+                            partition.triangles[index - frontierOffset].push_back(static_cast<int>(t));
+                            return;
+                        }
+                        if (not OctreeNode::intersectWithTriangle(centers[index], size / (1 << layer), point1, point2, point3, 0))
+                        {
+                            return;
+                        }
+                        partition.touched[index] = true;
+                        for (int r = 0; r < 8; r++)
+                        {
+                            self(self, layer + 1, x * 2 + (r >> 2), y * 2 + ((r >> 1) & 1), z * 2 + (r & 1));
+                        }
+                    };
+                    route(route, 0, 0, 0, 0);
+                }
+            });
+        }
+        group.wait();
+
+        // Apply what the triangles did above the frontier, parents first
+        for (int layer = 0; layer < frontierLayer; layer++)
+        {
+            int n = 1 << layer;
+            for (int x = 0; x < n; x++) for (int y = 0; y < n; y++) for (int z = 0; z < n; z++)
+            {
+                int index = nodeIndex(layer, x, y, z);
+                if (std::none_of(partitions.begin(), partitions.end(), [&](Partition const& p) { return p.touched[index]; }))
+                {
+                    continue;
+                }
+                OctreeNode* node = nodes[index];
+                node->isContainsMoveableChildren = true;
+                node->instantiateChildren(*this);
+                OctreeNode* childrenBase = resolve(node->children);
+                visitChildren(layer, x, y, z, [&](int r, int child) { nodes[child] = childrenBase + r; });
+            }
+        }
+
+        // Every frontier subtree on its own thread. A sub arena takes whole chunks and leaves the rest of its last one unused,
+        // so the subtrees share one per running task instead of taking one each. Tasks only run on the workers of the pool,
+        // which makes it at most one per worker.
+        std::vector<NodeAllocator> idleAllocators;
+        std::mutex allocatorMutex;
+        for (int frontier = 0; frontier < frontierCount; frontier++)
+        {
+            if (std::all_of(partitions.begin(), partitions.end(), [&](Partition const& p) { return p.triangles[frontier].empty(); }))
+            {
+                continue;
+            }
+            group.run([&, frontier]
+            {
+                std::vector<int> candidates;
+                for (Partition const& partition : partitions)
+                {
+                    candidates.insert(candidates.end(), partition.triangles[frontier].begin(), partition.triangles[frontier].end());
+                }
+                std::optional<NodeAllocator> allocator;
+                {
+                    auto const lock = std::scoped_lock{ allocatorMutex };
+                    if (not idleAllocators.empty())
+                    {
+                        allocator.emplace(std::move(idleAllocators.back()));
+                        idleAllocators.pop_back();
+                    }
+                }
+                if (not allocator)
+                {
+                    allocator.emplace(NodeAllocatorTraits::template clone<OctreeNode>(nodeAllocator));
+                }
+                buildTerrainSubtree(nodes[frontierOffset + frontier], *allocator, batch, candidates, maxLayer);
+                auto const lock = std::scoped_lock{ allocatorMutex };
+                idleAllocators.push_back(std::move(*allocator));
+            });
+        }
+        group.wait();
+        return true;
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::buildTerrainWithBudget(TriangleBatch const& batch, int maxLayer)
+    {
+        // A cell that has triangles and can be refined, with the triangles of every child
+        struct Refinement
+        {
+            OctreeNode* node;
+            std::vector<int> triangles;  // of child r in [childOffsets[r], childOffsets[r + 1])
+            std::array<std::uint32_t, 9> childOffsets;
+            int freeChildren;
+            std::size_t arrival;
+        };
+        // Refining gains the children without triangles, a thin cord among empty space gains most of them.
+        // On a tie the coarser cell comes first, and then the one that arrived first, so the result is deterministic.
+        auto lessImportant = [](Refinement const& a, Refinement const& b)
+        {
+            if (a.freeChildren != b.freeChildren)
+            {
+                return a.freeChildren < b.freeChildren;
+            }
+            if (a.node->layer != b.node->layer)
+            {
+                return a.node->layer > b.node->layer;
+            }
+            return a.arrival > b.arrival;
+        };
+        std::vector<Refinement> queue;
+        std::size_t arrivals = 0;
+        std::array<std::vector<int>, 8> childLists;
+        // Same as addTerrainTriangleList, except that the children are created when the cell leaves the queue
+        auto enqueue = [&](OctreeNode* node, std::span<int const> triangles)
+        {
+            node->isContainsMoveableChildren = true;
+            if (node->isMoveable)
+            {
+                return;
+            }
+            if (node->layer >= maxLayer)
+            {
+                node->isMoveable = true;
+                return;
+            }
+            float childSize = size / (1 << (node->layer + 1));
+            Vector3 centerPosition = node->center(*this);
+            for (auto& list : childLists)
+            {
+                list.clear();
+            }
+            for (int t : triangles)
+            {
+                unsigned int overlaps = triangleChildrenOverlap(centerPosition, childSize, 0, batch.vertices[batch.indices[t * 3 + 0]],
+                    batch.vertices[batch.indices[t * 3 + 1]], batch.vertices[batch.indices[t * 3 + 2]]);
+                for (int r = 0; r < 8; r++)
+                {
+                    if ((overlaps >> r) & 1)
+                    {
+                        childLists[r].push_back(t);
+                    }
+                }
+            }
+            Refinement refinement{ .node = node, .triangles = {}, .childOffsets = {}, .freeChildren = 0, .arrival = arrivals++ };
+            for (int r = 0; r < 8; r++)
+            {
+                refinement.triangles.insert(refinement.triangles.end(), childLists[r].begin(), childLists[r].end());
+                refinement.childOffsets[r + 1] = static_cast<std::uint32_t>(refinement.triangles.size());
+                refinement.freeChildren += childLists[r].empty();
+            }
+            queue.push_back(std::move(refinement));
+            std::push_heap(queue.begin(), queue.end(), lessImportant);
+        };
+
+        std::vector<int> triangles;
+        if (root->isMoveable)
+        {
+            triangles.resize(batch.size());
+            std::iota(triangles.begin(), triangles.end(), 0);
+        }
+        else
+        {
+            std::vector<int> candidates(batch.size());
+            std::iota(candidates.begin(), candidates.end(), 0);
+            appendTrianglesOverlappingBox(root->center(*this), root->size(*this), batch.vertices, batch.indices, candidates, triangles);
+        }
+        if (triangles.empty())
+        {
+            return;
+        }
+        enqueue(root, triangles);
+        while (not queue.empty())
+        {
+            std::pop_heap(queue.begin(), queue.end(), lessImportant);
+            Refinement refinement = std::move(queue.back());
+            queue.pop_back();
+            OctreeNode* node = refinement.node;
+            if (not canRefine(node))
+            {
+                node->isMoveable = true;
+                continue;
+            }
+            node->instantiateChildren(*this);
+            OctreeNode* childrenBase = resolve(node->children);
+            for (int r = 0; r < 8; r++)
+            {
+                auto begin = refinement.childOffsets[r];
+                auto end = refinement.childOffsets[r + 1];
+                if (begin != end)
+                {
+                    enqueue(childrenBase + r, std::span{ refinement.triangles }.subspan(begin, end - begin));
+                }
+            }
+        }
+    }
+
+    template<typename Allocator, typename NodeLayout>
+    void Octree<Allocator, NodeLayout>::addKeptTriangles(std::size_t firstTriangle, int maxLayer)
+    {
+        TriangleBatch batch{ keptVertices, keptIndices };
+        std::vector<int> candidates(batch.size() - firstTriangle);
+        std::iota(candidates.begin(), candidates.end(), static_cast<int>(firstTriangle));
+        std::vector<std::array<std::vector<int>, 8>> lists(std::max(maxLayer, 0) + 1);
+        // Also when the root is moveable, its row only gets the triangles that overlap it
+        std::vector<int>& triangles = lists[0][0];
+        appendTrianglesOverlappingBox(root->center(*this), root->size(*this), batch.vertices, batch.indices, candidates, triangles);
+        if (triangles.empty())
+        {
+            return;
+        }
+        root->addTerrainTriangleList(*this, nodeAllocator, batch, triangles, maxLayer, lists, &leafTriangles);
     }
 }
 
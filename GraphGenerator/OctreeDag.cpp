@@ -0,0 +1,281 @@
+#include "OctreeDag.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace GraphGenerator
+{
+    static_assert(std::endian::native == std::endian::little, "OCTDAG files are little endian");
+
+    namespace
+    {
+        // Octree::adjacentDirections
+        int constexpr directions[6][3] =
+        {
+            { 1, 0, 0 },
+            { -1, 0, 0 },
+            { 0, 1, 0 },
+            { 0, -1, 0 },
+            { 0, 0, 1 },
+            { 0, 0, -1 }
+        };
+        // Layers deeper than this would overflow the cell coordinates
+        int constexpr deepestLayer = 30;
+    }
+
+    bool OctreeDagCell::isLeaf() const noexcept
+    {
+        return slot < octreeDagFirstNode;
+    }
+
+    bool OctreeDagCell::isBlocked() const noexcept
+    {
+        return slot == octreeDagBlocked;
+    }
+
+    std::size_t OctreeDagBuilder::NodeHash::operator()(std::array<std::uint32_t, 8> const& children) const noexcept
+    {
+        std::uint64_t hash = 0;
+        for (std::uint32_t slot : children)
+        {
+            hash = (hash ^ slot) * 0x9E3779B97F4A7C15ULL;
+            hash ^= hash >> 32;
+        }
+        return static_cast<std::size_t>(hash);
+    }
+
+    std::uint32_t OctreeDagBuilder::add(std::array<std::uint32_t, 8> const& children)
+    {
+        auto [it, inserted] = slots.try_emplace(children, static_cast<std::uint32_t>(octreeDagFirstNode + nodes.size()));
+        if (inserted)
+        {
+            nodes.push_back(children);
+        }
+        return it->second;
+    }
+
+    std::size_t OctreeDagBuilder::nodeCount() const noexcept
+    {
+        return nodes.size();
+    }
+
+    std::vector<std::byte> OctreeDagBuilder::finish(float size, std::uint32_t root, int depth, std::uint64_t octreeNodeCount) const
+    {
+        OctreeDagHeader header = {};
+        std::memcpy(header.magic, octreeDagMagic, sizeof(header.magic));
+        header.version = octreeDagVersion;
+        header.size = size;
+        header.root = root;
+        header.depth = depth;
+        header.nodeCount = nodes.size();
+        header.octreeNodeCount = octreeNodeCount;
+        header.nodeOffset = sizeof(OctreeDagHeader);
+        header.fileSize = header.nodeOffset + nodes.size() * sizeof(nodes[0]);
+
+        std::vector<std::byte> result(header.fileSize);
+        std::memcpy(result.data(), &header, sizeof(header));
+        std::memcpy(result.data() + header.nodeOffset, nodes.data(), nodes.size() * sizeof(nodes[0]));
+        return result;
+    }
+
+    void writeOctreeDag(std::string const& path, std::span<std::byte const> dag)
+    {
+        auto stream = std::ofstream(path, std::ios::binary);
+        stream.write(reinterpret_cast<char const*>(dag.data()), static_cast<std::streamsize>(dag.size()));
+        stream.close();
+        if (not stream)
+        {
+            throw std::runtime_error{ "Cannot write " + path };
+        }
+    }
+
+    OctreeDagView::OctreeDagView(std::span<std::byte const> bytes) :
+        data{ bytes }
+    {
+        if (bytes.size() < sizeof(OctreeDagHeader))
+        {
+            throw std::runtime_error{ "Not an OCTDAG!" };
+        }
+        std::memcpy(&dagHeader, bytes.data(), sizeof(dagHeader));
+        auto const& header = dagHeader;
+        if (std::memcmp(header.magic, octreeDagMagic, sizeof(header.magic)) != 0)
+        {
+            throw std::runtime_error{ "Not an OCTDAG!" };
+        }
+        if (header.version != octreeDagVersion)
+        {
+            throw std::runtime_error{ "Unsupported OCTDAG version " + std::to_string(header.version) };
+        }
+        if (header.fileSize > bytes.size() or header.nodeOffset < sizeof(OctreeDagHeader) or
+            header.nodeOffset % alignof(std::uint32_t) != 0 or header.nodeOffset > header.fileSize or
+            header.nodeCount > (header.fileSize - header.nodeOffset) / sizeof(std::array<std::uint32_t, 8>) or
+            header.root >= octreeDagFirstNode + header.nodeCount or header.depth < 0 or header.depth > deepestLayer)
+        {
+            throw std::runtime_error{ "Corrupted OCTDAG!" };
+        }
+        data = bytes.first(header.fileSize);
+        // Slots only point back, so every walk ends, and no walk goes deeper than depth
+        std::vector<int> heights(nodes().size());
+        auto height = [&](std::uint32_t slot)
+        {
+            return slot < octreeDagFirstNode ? 0 : heights[slot - octreeDagFirstNode];
+        };
+        for (std::size_t i = 0; i < heights.size(); i++)
+        {
+            for (std::uint32_t slot : nodes()[i])
+            {
+                if (slot >= octreeDagFirstNode + i)
+                {
+                    throw std::runtime_error{ "Corrupted OCTDAG!" };
+                }
+                heights[i] = std::max(heights[i], height(slot) + 1);
+            }
+        }
+        if (height(header.root) != header.depth)
+        {
+            throw std::runtime_error{ "Corrupted OCTDAG!" };
+        }
+    }
+
+    OctreeDagHeader const& OctreeDagView::header() const noexcept
+    {
+        return dagHeader;
+    }
+
+    std::span<std::array<std::uint32_t, 8> const> OctreeDagView::nodes() const noexcept
+    {
+        return { reinterpret_cast<std::array<std::uint32_t, 8> const*>(data.data() + dagHeader.nodeOffset),
+            static_cast<std::size_t>(dagHeader.nodeCount) };
+    }
+
+    std::span<std::byte const> OctreeDagView::bytes() const noexcept
+    {
+        return data;
+    }
+
+    std::uint32_t OctreeDagView::child(std::uint32_t slot, int index) const noexcept
+    {
+        return nodes()[slot - octreeDagFirstNode][index];
+    }
+
+    OctreeDagCell OctreeDagView::cellAt(Vector3 const& position) const
+    {
+        // Centers are added up like the constructor of the wide nodes does, so both pick the same children
+        OctreeDagCell cell{ .layer = 0, .x = 0, .y = 0, .z = 0, .slot = dagHeader.root };
+        Vector3 center = Vector3{ .x = 0, .y = 0, .z = 0 };
+        while (not cell.isLeaf())
+        {
+            Vector3 diff = position - center;
+            int rx = diff.x <= 0;
+            int ry = diff.y <= 0;
+            int rz = diff.z <= 0;
+            cell.layer++;
+            center = center + dagHeader.size / (1 << cell.layer) *
+                Vector3{ .x = rx ? -1.f : 1.f, .y = ry ? -1.f : 1.f, .z = rz ? -1.f : 1.f };
+            cell.x = 2 * cell.x + rx;
+            cell.y = 2 * cell.y + ry;
+            cell.z = 2 * cell.z + rz;
+            cell.slot = child(cell.slot, 4 * rx + 2 * ry + rz);
+        }
+        return cell;
+    }
+
+    std::optional<OctreeDagCell> OctreeDagView::cellAt(int layer, int x, int y, int z) const
+    {
+        if (layer < 0 or layer > deepestLayer)
+        {
+            return std::nullopt;
+        }
+        int cells = 1 << layer;
+        if (x < 0 or y < 0 or z < 0 or x >= cells or y >= cells or z >= cells)
+        {
+            return std::nullopt;
+        }
+        OctreeDagCell cell{ .layer = 0, .x = 0, .y = 0, .z = 0, .slot = dagHeader.root };
+        for (int shift = layer - 1; shift >= 0 and not cell.isLeaf(); shift--)
+        {
+            int rx = (x >> shift) & 1;
+            int ry = (y >> shift) & 1;
+            int rz = (z >> shift) & 1;
+            cell = OctreeDagCell{ .layer = cell.layer + 1, .x = 2 * cell.x + rx, .y = 2 * cell.y + ry, .z = 2 * cell.z + rz,
+                .slot = child(cell.slot, 4 * rx + 2 * ry + rz) };
+        }
+        return cell;
+    }
+
+    std::optional<OctreeDagCell> OctreeDagView::adjacentCell(OctreeDagCell const& cell, int direction) const
+    {
+        return cellAt(cell.layer, cell.x + directions[direction][0], cell.y + directions[direction][1], cell.z + directions[direction][2]);
+    }
+
+    std::vector<OctreeDagCell> OctreeDagView::linkedCells(OctreeDagCell const& cell) const
+    {
+        std::vector<OctreeDagCell> result;
+        if (not cell.isBlocked() or cell.layer == 0)
+        {
+            return result;
+        }
+        for (int direction = 0; direction < 6; direction++)
+        {
+            auto found = adjacentCell(cell, direction);
+            if (not found)
+            {
+                continue;
+            }
+            if (found->isLeaf())
+            {
+                // A coarser or equal blocked leaf is linked from this side
+                if (found->isBlocked())
+                {
+                    result.push_back(*found);
+                }
+                continue;
+            }
+            // The deeper blocked leaves along the shared side find this cell and link to it.
+            // Going up along an axis, the side that faces back has the child bit 0.
+            appendBlockedLeavesOnSide(*found, direction / 2, direction % 2 == 0 ? 0 : 1, result);
+        }
+        return result;
+    }
+
+    void OctreeDagView::appendBlockedLeavesOnSide(OctreeDagCell const& cell, int axis, int side, std::vector<OctreeDagCell>& result) const
+    {
+        for (int r = 0; r < 8; r++)
+        {
+            if (((r >> (2 - axis)) & 1) != side)
+            {
+                continue;
+            }
+            int rx = (r >> 2) & 1;
+            int ry = (r >> 1) & 1;
+            int rz = r & 1;
+            OctreeDagCell next{ .layer = cell.layer + 1, .x = 2 * cell.x + rx, .y = 2 * cell.y + ry, .z = 2 * cell.z + rz,
+                .slot = child(cell.slot, r) };
+            if (not next.isLeaf())
+            {
+                appendBlockedLeavesOnSide(next, axis, side, result);
+            }
+            else if (next.isBlocked())
+            {
+                result.push_back(next);
+            }
+        }
+    }
+
+    OctreeDagFile::OctreeDagFile(std::string const& path) :
+        dag{ map(path, file) }
+    {}
+
+    OctreeDagView const& OctreeDagFile::view() const noexcept
+    {
+        return dag;
+    }
+
+    std::span<std::byte const> OctreeDagFile::map(std::string const& path, decltype(file)& file)
+    {
+        file.open(path);
+        return { static_cast<std::byte const*>(file.data), file.size };
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef OCTREE_DAG_HPP
+#define OCTREE_DAG_HPP
+
+#include "Vector3.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include "Windows/MappedFile.hpp"
+#else
+#include "Unix/MappedFile.hpp"
+#endif // _WIN32
+
+namespace GraphGenerator
+{
+    // Binary OCTDAG file, little endian:
+    // [header, 64 bytes][uint32 nodes[nodeCount][8]]
+    // An octree as a sparse voxel DAG, every distinct subtree is stored once and shared by all places it occurs.
+    // A node holds the slots of its 8 children in the order of OctreeNode::children. A slot is octreeDagEmpty for a leaf
+    // without a mesh, octreeDagBlocked for a moveable leaf, or octreeDagFirstNode + the index of a node.
+    // Children come before their parents, so a node only refers to nodes with lower indices.
+    struct OctreeDagHeader
+    {
+        char magic[12];
+        std::uint32_t version;
+        float size;  // Octree::size, half the edge of the root cell
+        std::uint32_t root;  // slot of the root
+        std::int32_t depth;  // deepest layer of the octree
+        std::uint32_t reserved;
+        std::uint64_t nodeCount;
+        std::uint64_t octreeNodeCount;  // nodes of the octree the DAG was made from
+        std::uint64_t nodeOffset;  // in bytes, from the beginning of the header
+        std::uint64_t fileSize;  // in bytes, header + nodes
+    };
+    static_assert(sizeof(OctreeDagHeader) == 64);
+
+    inline constexpr char octreeDagMagic[12] = "OCTDAG";
+    inline constexpr std::uint32_t octreeDagVersion = 1;
+    inline constexpr std::uint32_t octreeDagEmpty = 0;
+    inline constexpr std::uint32_t octreeDagBlocked = 1;
+    inline constexpr std::uint32_t octreeDagFirstNode = 2;
+
+    // A place in the octree that a DAG stands for, with the cell of the octree node there
+    struct OctreeDagCell
+    {
+        int layer;
+        // Same as OctreeNode::worldIndex0..2
+        int x;
+        int y;
+        int z;
+        std::uint32_t slot;
+
+        bool isLeaf() const noexcept;
+        bool isBlocked() const noexcept;
+    };
+
+    // Collects the nodes of an OCTDAG bottom up. A node with the same child slots as an earlier one gets its slot,
+    // which merges identical subtrees because their children already got the same slots.
+    class OctreeDagBuilder
+    {
+    public:
+        // Children have to be added before their parents
+        std::uint32_t add(std::array<std::uint32_t, 8> const& children);
+        std::size_t nodeCount() const noexcept;
+        std::vector<std::byte> finish(float size, std::uint32_t root, int depth, std::uint64_t octreeNodeCount) const;
+
+    private:
+        struct NodeHash
+        {
+            std::size_t operator()(std::array<std::uint32_t, 8> const& children) const noexcept;
+        };
+        std::vector<std::array<std::uint32_t, 8>> nodes;
+        std::unordered_map<std::array<std::uint32_t, 8>, std::uint32_t, NodeHash> slots;
+    };
+
+    // Throws std::runtime_error if the file cannot be written
+    void writeOctreeDag(std::string const& path, std::span<std::byte const> dag);
+
+    // Zero copy view of an OCTDAG, the queries walk the DAG like the octree walks its nodes
+    class OctreeDagView
+    {
+    public:
+        // Validates the header and every slot, throws std::runtime_error if invalid
+        explicit OctreeDagView(std::span<std::byte const> bytes);
+
+        OctreeDagHeader const& header() const noexcept;
+        std::span<std::array<std::uint32_t, 8> const> nodes() const noexcept;
+        std::span<std::byte const> bytes() const noexcept;
+
+        // Deepest cell that contains position, same as Octree::positionToNode
+        OctreeDagCell cellAt(Vector3 const& position) const;
+        // Deepest cell at most layer deep that contains the cell (layer, x, y, z), std::nullopt outside of the octree
+        std::optional<OctreeDagCell> cellAt(int layer, int x, int y, int z) const;
+        // Same as Octree::findAdjacentNode, directions as in Octree::adjacentDirections
+        std::optional<OctreeDagCell> adjacentCell(OctreeDagCell const& cell, int direction) const;
+        // The cells calculateTerrainPathGraph links a blocked leaf to, empty for other cells
+        std::vector<OctreeDagCell> linkedCells(OctreeDagCell const& cell) const;
+
+    private:
+        std::span<std::byte const> data;
+        OctreeDagHeader dagHeader;
+
+        std::uint32_t child(std::uint32_t slot, int index) const noexcept;
+        // Appends the blocked leaves below cell whose cells touch its side, axis and side as in the child index bits
+        void appendBlockedLeavesOnSide(OctreeDagCell const& cell, int axis, int side, std::vector<OctreeDagCell>& result) const;
+    };
+
+    // Memory mapped OCTDAG file
+    class OctreeDagFile
+    {
+    public:
+        explicit OctreeDagFile(std::string const& path);
+
+        OctreeDagView const& view() const noexcept;
+
+    private:
+#ifdef _WIN32
+        Windows::MappedFile file;
+#else
+        Unix::MappedFile file;
+#endif // _WIN32
+        OctreeDagView dag;
+
+        static std::span<std::byte const> map(std::string const& path, decltype(file)& file);
+    };
+}
+
+#endif // !OCTREE_DAG_HPP
@@ -0,0 +1,116 @@
+#include "OctreeSnapshot.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace GraphGenerator
+{
+    static_assert(std::endian::native == std::endian::little, "OCTREE snapshots are little endian");
+
+    namespace
+    {
+        std::uint64_t alignUp(std::uint64_t value) noexcept
+        {
+            return (value + octreeSnapshotAlignment - 1) / octreeSnapshotAlignment * octreeSnapshotAlignment;
+        }
+
+        void writePadding(std::ostream& stream, std::uint64_t from, std::uint64_t to)
+        {
+            static char constexpr zeros[octreeSnapshotAlignment] = {};
+            stream.write(zeros, static_cast<std::streamsize>(to - from));
+        }
+    }
+
+    std::uint64_t writeOctreeSnapshot(std::string const& path, OctreeSnapshotHeader header,
+        std::span<std::span<std::byte const> const> segments, std::span<std::uint32_t const> metadata)
+    {
+        std::memcpy(header.magic, octreeSnapshotMagic, sizeof(header.magic));
+        header.version = octreeSnapshotVersion;
+        header.segmentCount = static_cast<std::uint32_t>(segments.size());
+        header.metadataOffset = sizeof(OctreeSnapshotHeader) + segments.size() * sizeof(OctreeSnapshotSegment);
+        header.metadataSize = metadata.size();
+        std::vector<OctreeSnapshotSegment> table(segments.size());
+        std::uint64_t end = header.metadataOffset + metadata.size() * sizeof(std::uint32_t);
+        for (std::size_t i = 0; i < segments.size(); i++)
+        {
+            table[i].offset = alignUp(end);
+            table[i].bytes = segments[i].size();
+            end = table[i].offset + table[i].bytes;
+        }
+        header.fileSize = alignUp(end);
+
+        auto stream = std::ofstream(path, std::ios::binary);
+        stream.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<char const*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(OctreeSnapshotSegment)));
+        stream.write(reinterpret_cast<char const*>(metadata.data()), static_cast<std::streamsize>(metadata.size() * sizeof(std::uint32_t)));
+        end = header.metadataOffset + metadata.size() * sizeof(std::uint32_t);
+        for (std::size_t i = 0; i < segments.size(); i++)
+        {
+            writePadding(stream, end, table[i].offset);
+            stream.write(reinterpret_cast<char const*>(segments[i].data()), static_cast<std::streamsize>(segments[i].size()));
+            end = table[i].offset + table[i].bytes;
+        }
+        writePadding(stream, end, header.fileSize);
+        stream.close();
+        if (not stream)
+        {
+            throw std::runtime_error{ "Cannot write " + path };
+        }
+        return header.fileSize;
+    }
+
+    OctreeSnapshotFile::OctreeSnapshotFile(std::string const& path)
+    {
+        file.open(path);
+        auto bytes = std::span{ static_cast<std::byte const*>(file.data), file.size };
+        if (bytes.size() < sizeof(OctreeSnapshotHeader))
+        {
+            throw std::runtime_error{ "Not an OCTREE snapshot!" };
+        }
+        std::memcpy(&snapshotHeader, bytes.data(), sizeof(snapshotHeader));
+        auto const& header = snapshotHeader;
+        if (std::memcmp(header.magic, octreeSnapshotMagic, sizeof(header.magic)) != 0)
+        {
+            throw std::runtime_error{ "Not an OCTREE snapshot!" };
+        }
+        if (header.version != octreeSnapshotVersion)
+        {
+            throw std::runtime_error{ "Unsupported OCTREE snapshot version " + std::to_string(header.version) };
+        }
+        std::uint64_t tableEnd = sizeof(OctreeSnapshotHeader) + std::uint64_t{ header.segmentCount } * sizeof(OctreeSnapshotSegment);
+        if (header.fileSize > bytes.size() or header.fileSize % octreeSnapshotAlignment != 0 or
+            header.metadataOffset < tableEnd or header.metadataOffset % alignof(std::uint32_t) != 0 or
+            header.metadataOffset > header.fileSize or header.metadataSize > (header.fileSize - header.metadataOffset) / sizeof(std::uint32_t))
+        {
+            throw std::runtime_error{ "Corrupted OCTREE snapshot!" };
+        }
+        for (auto const& segment : segments())
+        {
+            if (segment.offset % octreeSnapshotAlignment != 0 or segment.offset > header.fileSize or
+                segment.bytes > header.fileSize - segment.offset)
+            {
+                throw std::runtime_error{ "Corrupted OCTREE snapshot!" };
+            }
+        }
+    }
+
+    OctreeSnapshotHeader const& OctreeSnapshotFile::header() const noexcept
+    {
+        return snapshotHeader;
+    }
+
+    std::span<OctreeSnapshotSegment const> OctreeSnapshotFile::segments() const noexcept
+    {
+        return { reinterpret_cast<OctreeSnapshotSegment const*>(static_cast<std::byte const*>(file.data) + sizeof(OctreeSnapshotHeader)),
+            snapshotHeader.segmentCount };
+    }
+
+    std::span<std::uint32_t const> OctreeSnapshotFile::metadata() const noexcept
+    {
+        return { reinterpret_cast<std::uint32_t const*>(static_cast<std::byte const*>(file.data) + snapshotHeader.metadataOffset),
+            static_cast<std::size_t>(snapshotHeader.metadataSize) };
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef OCTREE_SNAPSHOT_HPP
+#define OCTREE_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#ifdef _WIN32
+#include "Windows/MappedFile.hpp"
+#else
+#include "Unix/MappedFile.hpp"
+#endif // _WIN32
+
+namespace GraphGenerator
+{
+    // Binary OCTREE snapshot, little endian:
+    // [header, 80 bytes][segment table][uint32 metadata][segment 0]...[segment n - 1]
+    // The segments are the node memory of the arena as it was, they start at a multiple of octreeSnapshotAlignment
+    // and are padded to one, so they can be mapped back at any address. Nodes refer to each other by handles,
+    // the metadata holds the handles of the components and of the frozen path graph.
+    // A snapshot can only be read by a build with the same node layout, see nodeSize.
+    struct OctreeSnapshotHeader
+    {
+        char magic[12];
+        std::uint32_t version;
+        std::uint32_t nodeSize;  // sizeof(OctreeNode) of the build that wrote the snapshot
+        std::uint32_t segmentCount;
+        float size;
+        float radius;
+        std::int32_t minLayer;
+        std::uint32_t root;  // handle of the root node
+        std::int32_t largestComponent;
+        std::int32_t nodesNumber;
+        std::uint64_t numberOfNodes;
+        std::uint64_t metadataOffset;  // in bytes, from the beginning of the header
+        std::uint64_t metadataSize;  // in uint32
+        std::uint64_t fileSize;  // in bytes, header + blocks + padding
+    };
+    static_assert(sizeof(OctreeSnapshotHeader) == 80);
+
+    struct OctreeSnapshotSegment
+    {
+        std::uint64_t offset;  // in bytes, from the beginning of the header
+        std::uint64_t bytes;
+    };
+
+    inline constexpr char octreeSnapshotMagic[12] = "OCTREE";
+    // Version 2 stores the cells of the nodes with 17 bits per coordinate
+    inline constexpr std::uint32_t octreeSnapshotVersion = 2;
+    // Allocation granularity of Windows, a multiple of the page size everywhere
+    inline constexpr std::size_t octreeSnapshotAlignment = 64 * 1024;
+
+    // Fills in segmentCount and the offsets and sizes of header, returns the number of bytes written.
+    // Throws std::runtime_error if the file cannot be written.
+    std::uint64_t writeOctreeSnapshot(std::string const& path, OctreeSnapshotHeader header,
+        std::span<std::span<std::byte const> const> segments, std::span<std::uint32_t const> metadata);
+
+    // Memory mapped OCTREE snapshot, the segments themselves are mapped by the node allocator
+    class OctreeSnapshotFile
+    {
+    public:
+        // Validates the header, the segment table and the metadata range, throws std::runtime_error if invalid
+        explicit OctreeSnapshotFile(std::string const& path);
+
+        OctreeSnapshotHeader const& header() const noexcept;
+        std::span<OctreeSnapshotSegment const> segments() const noexcept;
+        std::span<std::uint32_t const> metadata() const noexcept;
+
+    private:
+#ifdef _WIN32
+        Windows::MappedFile file;
+#else
+        Unix::MappedFile file;
+#endif // _WIN32
+        OctreeSnapshotHeader snapshotHeader;
+    };
+}
+
+#endif // !OCTREE_SNAPSHOT_HPP
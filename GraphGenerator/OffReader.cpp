@@ -0,0 +1,148 @@
+#include "OffReader.hpp"
+#ifdef _WIN32
+#include "Windows/MappedFile.hpp"
+using GraphGenerator::Windows::MappedFile;
+#else
+#include "Unix/MappedFile.hpp"
+using GraphGenerator::Unix::MappedFile;
+#endif // _WIN32
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+
+namespace GraphGenerator
+{
+    namespace
+    {
+        class OffParser
+        {
+        public:
+            OffParser(std::string_view text) noexcept :
+                current{ text.data() },
+                end{ text.data() + text.size() }
+            {}
+
+            std::string_view token() noexcept
+            {
+                skipWhitespace();
+                char const* begin = current;
+                while (current != end and not isWhitespace(*current))
+                {
+                    ++current;
+                }
+                return { begin, static_cast<std::size_t>(current - begin) };
+            }
+
+            template<typename T>
+            T number()
+            {
+                skipWhitespace();
+                T value = {};
+                auto [next, error] = std::from_chars(current, end, value);
+                if (error != std::errc{})
+                {
+                    throw std::runtime_error{ current == end ? "Unexpected end of file!" : "Invalid number!" };
+                }
+                current = next;
+                return value;
+            }
+
+        private:
+            char const* current;
+            char const* end;
+
+            static bool isWhitespace(char c) noexcept
+            {
+                return c == ' ' or c == '\n' or c == '\r' or c == '\t';
+            }
+
+            void skipWhitespace() noexcept
+            {
+                while (current != end and isWhitespace(*current))
+                {
+                    ++current;
+                }
+            }
+        };
+    }
+
+    OffMesh parseOff(std::string_view text)
+    {
+        OffParser parser{ text };
+        std::string_view head = parser.token();
+        if (not head.starts_with("OFF"))
+        {
+            throw std::runtime_error{ "Not an OFF file!" };
+        }
+        int vertexCount = 0;
+        int faceCount = 0;
+        // Normal case
+        if (head == "OFF")
+        {
+            vertexCount = parser.number<int>();
+        }
+        else
+        {
+            OffParser fused{ head.substr(3) };
+            vertexCount = fused.number<int>();
+        }
+        faceCount = parser.number<int>();
+        // edge count, unused
+        parser.number<int>();
+        if (vertexCount < 0 or faceCount < 0)
+        {
+            throw std::runtime_error{ "Invalid element count!" };
+        }
+        // A vertex takes at least "0 0 0\n" and a face "3 0 0 0\n", so a corrupt header cannot make us allocate more than the text
+        if (static_cast<std::size_t>(vertexCount) * 6 + static_cast<std::size_t>(faceCount) * 8 > text.size())
+        {
+            throw std::runtime_error{ "Element count exceeds the file size!" };
+        }
+
+        OffMesh mesh;
+        mesh.vertices.reserve(vertexCount);
+        mesh.indices.reserve(static_cast<std::size_t>(faceCount) * 3);
+        float constexpr fMax = std::numeric_limits<float>::max();
+        float constexpr fLowest = std::numeric_limits<float>::lowest();
+        mesh.min = Vector3{ .x = fMax, .y = fMax, .z = fMax };
+        mesh.max = Vector3{ .x = fLowest, .y = fLowest, .z = fLowest };
+        for (int i = 0; i < vertexCount; i++)
+        {
+            Vector3& vertex = mesh.vertices.emplace_back();
+            vertex.x = parser.number<float>();
+            vertex.y = parser.number<float>();
+            vertex.z = parser.number<float>();
+            mesh.min.x = vertex.x < mesh.min.x ? vertex.x : mesh.min.x;
+            mesh.min.y = vertex.y < mesh.min.y ? vertex.y : mesh.min.y;
+            mesh.min.z = vertex.z < mesh.min.z ? vertex.z : mesh.min.z;
+            mesh.max.x = vertex.x > mesh.max.x ? vertex.x : mesh.max.x;
+            mesh.max.y = vertex.y > mesh.max.y ? vertex.y : mesh.max.y;
+            mesh.max.z = vertex.z > mesh.max.z ? vertex.z : mesh.max.z;
+        }
+        for (int i = 0; i < faceCount; i++)
+        {
+            int shape = parser.number<int>();
+            if (shape != 3)
+            {
+                throw std::runtime_error{ "Not a triangle! Vertex id = " + std::to_string(i) + " value = " + std::to_string(shape) };
+            }
+            for (int j = 0; j < 3; j++)
+            {
+                int index = parser.number<int>();
+                if (index < 0 or index >= vertexCount)
+                {
+                    throw std::runtime_error{ "Vertex index out of range! Face id = " + std::to_string(i) + " value = " + std::to_string(index) };
+                }
+                mesh.indices.push_back(index);
+            }
+        }
+        return mesh;
+    }
+
+    OffMesh readOffFile(std::string const& path)
+    {
+        MappedFile file;
+        file.open(path);
+        return parseOff({ static_cast<char const*>(file.data), file.size });
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef OFF_READER_HPP
+#define OFF_READER_HPP
+
+#include "Vector3.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace GraphGenerator
+{
+    // Triangle mesh stored as flat arrays, ready to be fed into the octree
+    struct OffMesh
+    {
+        std::vector<Vector3> vertices;
+        std::vector<int> indices;  // 3 vertex indices per triangle
+        // Bounding box, computed while parsing
+        Vector3 min{};
+        Vector3 max{};
+
+        int triangleCount() const noexcept
+        {
+            return static_cast<int>(indices.size() / 3);
+        }
+    };
+
+    // Parses both the "OFF\n<v> <f> <e>" header and the fused "OFF<v> <f> <e>" variant found in ModelNet.
+    // Throws std::runtime_error if the text is not a triangle OFF mesh.
+    OffMesh parseOff(std::string_view text);
+    // Memory maps the file and parses it in place, without any intermediate copies.
+    OffMesh readOffFile(std::string const& path);
+}
+
+#endif // !OFF_READER_HPP
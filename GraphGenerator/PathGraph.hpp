@@ -8,6 +8,7 @@
 #include <memory>
 #include <queue>
 #include <span>
+#include <string>
 #include <vector>
 
 namespace GraphGenerator
@@ -16,7 +17,7 @@ namespace GraphGenerator
     class PathGraphDataClass
     {
     private:
-        using OctreeNodeRef = typename OctreeType::OctreeNode::NodeRef;
+        using OctreeNodeRef = typename OctreeType::NodeRef;
         using SizeType = std::conditional_t<sizeof(OctreeNodeRef) == 4, std::uint32_t, std::size_t>;
         static SizeType constexpr elementSize = static_cast<SizeType>(sizeof(OctreeNodeRef));
         static SizeType constexpr metadataSize = static_cast<SizeType>(sizeof(SizeType) * 2);
@@ -46,7 +47,7 @@ namespace GraphGenerator
     class PathGraphNodeAStarInfoClass
     {
     public:
-        using OctreeNodeRef = typename OctreeType::OctreeNode::NodeRef;
+        using OctreeNodeRef = typename OctreeType::NodeRef;
 
         OctreeNodeRef node = OctreeNodeRef{};
         OctreeNodeRef parent = OctreeNodeRef{};
@@ -71,19 +72,33 @@ namespace GraphGenerator
         int nodesNumber;
 
         PathGraph(float size, float radius, int minLayer = 0, typename OctreeType::NodeAllocator&& nodeAllocator = {});
+        explicit PathGraph(std::string const& snapshotPath);
+        // Copy of the octree of other in a new arena
+        explicit PathGraph(Octree& other);
         PathGraph& operator=(PathGraph&&) = delete;
         ~PathGraph() override;
 
         void addTerrainTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer, 
             bool considerRadius) override;
+        void addTerrainTriangleArrayMesh(std::span<Vector3 const> vertices, std::span<int const> indices, int maxLayer,
+            bool considerRadius, ThreadPool* pool = nullptr) override;
         void addRuntimeTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3, int maxLayer,
             bool considerRadius, int runtimeMeshIndex) override;
         void removeRuntimeMesh(int runtimeMeshIndex) override;
-        void calculateTerrainPathGraph() override;
+        void setNodeBudget(std::size_t nodes) override;
+        void collapseToLayer(int layer) override;
+        void setRefinable(bool refinable) override;
+        void refineTo(int layer) override;
+        void calculateTerrainPathGraph(ThreadPool* pool = nullptr) override;
         void calculateRuntimePathGraph() override;
+        void save(std::string const& path) override;
+        IPathGraph* clone() override;
+        std::vector<std::byte> compressToDag() override;
         int samplePosition(Vector3 position, float radius, int scc, Vector3& result) override;
         int getComponentTotalCount() override;
         int getComponentSize(int index) override;
+        int getComponentEdgeCount(int index) override;
+        int getLargestComponent() override;
         std::pair<std::vector<Vector3>, std::vector<std::pair<int, int>>> getComponentGraph(int index, bool rotate) override;
         std::vector<std::vector<Vector3>> getComponentColorGraph(int index, int layer) override;
         //std::vector<std::vector<Vector3>> getComponentGridGraph(int index, int size) override;
@@ -105,6 +105,20 @@ namespace GraphGenerator
         nodesNumber = 0;
     }
 
+    template<typename OctreeType>
+    PathGraph<OctreeType>::PathGraph(std::string const& snapshotPath)
+    {
+        nodesNumber = 0;
+        this->octree = new Octree{ this, snapshotPath };
+    }
+
+    template<typename OctreeType>
+    PathGraph<OctreeType>::PathGraph(Octree& other)
+    {
+        nodesNumber = other.graph->nodesNumber;
+        this->octree = new Octree{ this, other };
+    }
+
     template<typename OctreeType>
     PathGraph<OctreeType>::~PathGraph()
     {
@@ -118,6 +132,13 @@ namespace GraphGenerator
         octree->addTerrainTriangleMesh(point1, point2, point3, maxLayer, considerRadius);
     }
 
+    template<typename OctreeType>
+    void PathGraph<OctreeType>::addTerrainTriangleArrayMesh(std::span<Vector3 const> vertices, std::span<int const> indices,
+        int maxLayer, bool considerRadius, ThreadPool* pool)
+    {
+        octree->addTerrainTriangleArrayMesh(vertices, indices, maxLayer, considerRadius, pool);
+    }
+
     template<typename OctreeType>
     void PathGraph<OctreeType>::addRuntimeTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
         int maxLayer, bool considerRadius, int runtimeMeshIndex)
@@ -132,9 +153,33 @@ namespace GraphGenerator
     }
 
     template<typename OctreeType>
-    void PathGraph<OctreeType>::calculateTerrainPathGraph()
+    void PathGraph<OctreeType>::setNodeBudget(std::size_t nodes)
+    {
+        octree->nodeBudget = nodes;
+    }
+
+    template<typename OctreeType>
+    void PathGraph<OctreeType>::collapseToLayer(int layer)
+    {
+        octree->collapseToLayer(layer);
+    }
+
+    template<typename OctreeType>
+    void PathGraph<OctreeType>::setRefinable(bool refinable)
+    {
+        octree->setRefinable(refinable);
+    }
+
+    template<typename OctreeType>
+    void PathGraph<OctreeType>::refineTo(int layer)
+    {
+        octree->refineTo(layer);
+    }
+
+    template<typename OctreeType>
+    void PathGraph<OctreeType>::calculateTerrainPathGraph(ThreadPool* pool)
     {
-        octree->calculateTerrainPathGraph();
+        octree->calculateTerrainPathGraph(pool);
     }
 
     template<typename OctreeType>
@@ -143,6 +188,24 @@ namespace GraphGenerator
         octree->calculateRuntimePathGraph();
     }
 
+    template<typename OctreeType>
+    void PathGraph<OctreeType>::save(std::string const& path)
+    {
+        octree->save(path);
+    }
+
+    template<typename OctreeType>
+    IPathGraph* PathGraph<OctreeType>::clone()
+    {
+        return new PathGraph{ *octree };
+    }
+
+    template<typename OctreeType>
+    std::vector<std::byte> PathGraph<OctreeType>::compressToDag()
+    {
+        return octree->compressToDag();
+    }
+
     template<typename OctreeType>
     int PathGraph<OctreeType>::samplePosition(Vector3 position, float radius, int scc, Vector3& result)
     {
@@ -152,13 +215,30 @@ namespace GraphGenerator
     template<typename OctreeType>
     int PathGraph<OctreeType>::getComponentTotalCount()
     {
-        return static_cast<int>(octree->componentMap.size());
+        return octree->componentCount();
     }
 
     template<typename OctreeType>
     int PathGraph<OctreeType>::getComponentSize(int index)
     {
-        return octree->componentMap[index].second;
+        return static_cast<int>(octree->componentView(index).size());
+    }
+
+    template<typename OctreeType>
+    int PathGraph<OctreeType>::getComponentEdgeCount(int index)
+    {
+        std::size_t count = 0;
+        for (OctreeNode* q : octree->componentView(index))
+        {
+            count += octree->pathGraphEdgesOf(q).size();
+        }
+        return static_cast<int>(count);
+    }
+
+    template<typename OctreeType>
+    int PathGraph<OctreeType>::getLargestComponent()
+    {
+        return octree->largestComponent;
     }
 
     std::vector<Vector3> static inline centerAndScale(const std::vector<Vector3>& data) {
@@ -220,29 +300,17 @@ namespace GraphGenerator
     template<typename OctreeType>
     std::pair<std::vector<Vector3>, std::vector<std::pair<int, int>>> PathGraph<OctreeType>::getComponentGraph(int index, bool rotate)
     {
-        std::vector<OctreeNode*> leaves;
-        octree->root->leaves(leaves);
+        auto nodes = octree->componentView(index);
         std::vector<Vector3> resultPositions;
-        std::unordered_map<OctreeNode*, int> indexMap;
-        for (OctreeNode* q : leaves)
-        {
-            q->runtimeMoveableCounter = 0;
-            if (q->pathGraphConnectComponentIndex == index)
-            {
-                indexMap.insert({ q, static_cast<int>(indexMap.size()) });
-                resultPositions.push_back(q->centerPosition);
-            }
-        }
-
+        resultPositions.reserve(nodes.size());
         std::vector<std::pair<int, int>> resultLinks;
-        for (OctreeNode* q : leaves)
+        for (OctreeNode* q : nodes)
         {
-            if (q->pathGraphConnectComponentIndex == index)
+            resultPositions.push_back(q->center(*octree));
+            for (auto& toRef : octree->pathGraphEdgesOf(q))
             {
-                for (auto& toRef : q->pathGraphEdges.view())
-                {
-                    resultLinks.push_back({ indexMap[q], indexMap[octree->resolve(toRef)] });
-                }
+                resultLinks.push_back({ static_cast<int>(octree->componentPositionOf(q)),
+                    static_cast<int>(octree->componentPositionOf(octree->resolve(toRef))) });
             }
         }
 
@@ -259,38 +327,29 @@ namespace GraphGenerator
     template<typename OctreeType>
     std::vector<std::vector<Vector3>> PathGraph<OctreeType>::getComponentColorGraph(int index, int layer)
     {
-        std::vector<OctreeNode*> leaves;
-        octree->root->leaves(leaves);
-        std::unordered_map<OctreeNode*, int> indexMap;
+        auto nodes = octree->componentView(index);
         Vector3 center{ .x = 0, .y = 0, .z = 0 };
-        for (OctreeNode* q : leaves)
+        for (OctreeNode* q : nodes)
         {
-            q->runtimeMoveableCounter = 0;
-            if (q->pathGraphConnectComponentIndex == index)
-            {
-                indexMap.insert({ q, static_cast<int>(indexMap.size()) });
-                center = center + q->centerPosition;
-            }
+            center = center + q->center(*octree);
         }
-        center = center / indexMap.size();
+        center = center / nodes.size();
 
-        std::vector<std::vector<Vector3>> result(indexMap.size(), std::vector<Vector3>(indexMap.size(), Vector3{ .x = 0, .y = 0, .z = 0 }));
-        for (OctreeNode* q : leaves)
+        std::vector<std::vector<Vector3>> result(nodes.size(), std::vector<Vector3>(nodes.size(), Vector3{ .x = 0, .y = 0, .z = 0 }));
+        for (OctreeNode* from : nodes)
         {
-            if (q->pathGraphConnectComponentIndex == index)
+            for (auto& toRef : octree->pathGraphEdgesOf(from))
             {
-                for (auto& toRef : q->pathGraphEdges.view())
-                {
-                    auto from = q;
-                    auto to = octree->resolve(toRef);
-                    auto& pos = result[indexMap[from]][indexMap[to]];
-                    //pos.x = 0;
-                    //pos.y = 1;
-                    //pos.z = 1;
-                    pos.x = (from->centerPosition - to->centerPosition).length() * std::pow(2, layer);
-                    pos.y = dot((from->centerPosition - to->centerPosition).normalized(), (center - to->centerPosition).normalized()) / 2 + 0.5f;
-                    pos.z = dot((to->centerPosition - from->centerPosition).normalized(), (center - from->centerPosition).normalized()) / 2 + 0.5f;
-                }
+                auto to = octree->resolve(toRef);
+                auto& pos = result[octree->componentPositionOf(from)][octree->componentPositionOf(to)];
+                Vector3 fromCenter = from->center(*octree);
+                Vector3 toCenter = to->center(*octree);
+                //pos.x = 0;
+                //pos.y = 1;
+                //pos.z = 1;
+                pos.x = (fromCenter - toCenter).length() * std::pow(2, layer);
+                pos.y = dot((fromCenter - toCenter).normalized(), (center - toCenter).normalized()) / 2 + 0.5f;
+                pos.z = dot((toCenter - fromCenter).normalized(), (center - fromCenter).normalized()) / 2 + 0.5f;
             }
         }
         return result;
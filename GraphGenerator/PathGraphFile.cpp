@@ -0,0 +1,149 @@
+#include "PathGraphFile.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace GraphGenerator
+{
+    static_assert(std::endian::native == std::endian::little, "binary PATHGRAPH files are little endian");
+    static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 is written and mapped as float[3]");
+
+    namespace
+    {
+        std::uint64_t alignUp(std::uint64_t value) noexcept
+        {
+            return (value + pathGraphFileAlignment - 1) / pathGraphFileAlignment * pathGraphFileAlignment;
+        }
+
+        void writePadding(std::ostream& stream, std::uint64_t from, std::uint64_t to)
+        {
+            char constexpr zeros[pathGraphFileAlignment] = {};
+            stream.write(zeros, static_cast<std::streamsize>(to - from));
+        }
+    }
+
+    void writePathGraphText(std::ostream& stream, std::vector<Vector3> const& positions, std::vector<std::pair<int, int>> const& links)
+    {
+        stream << "PATHGRAPH" << std::endl;
+        stream << positions.size() << " " << links.size() << std::endl;
+        for (auto& position : positions)
+        {
+            stream << position.x << " " << position.y << " " << position.z << std::endl;
+        }
+        for (auto& link : links)
+        {
+            stream << link.first << " " << link.second << std::endl;
+        }
+    }
+
+    void writePathGraphText(std::ostream& stream, PathGraphView const& graph)
+    {
+        stream << "PATHGRAPH" << std::endl;
+        stream << graph.vertexCount() << " " << graph.edgeCount() << std::endl;
+        for (auto& position : graph.vertices())
+        {
+            stream << position.x << " " << position.y << " " << position.z << std::endl;
+        }
+        auto edges = graph.edges();
+        for (std::size_t i = 0; i < edges.size(); i += 2)
+        {
+            stream << edges[i] << " " << edges[i + 1] << std::endl;
+        }
+    }
+
+    std::uint64_t writePathGraphBinary(std::ostream& stream, std::vector<Vector3> const& positions, std::vector<std::pair<int, int>> const& links)
+    {
+        PathGraphFileHeader header = {};
+        std::memcpy(header.magic, pathGraphFileMagic, sizeof(header.magic));
+        header.version = pathGraphFileVersion;
+        header.vertexCount = positions.size();
+        header.edgeCount = links.size();
+        header.vertexOffset = alignUp(sizeof(PathGraphFileHeader));
+        header.edgeOffset = alignUp(header.vertexOffset + header.vertexCount * sizeof(Vector3));
+        header.size = alignUp(header.edgeOffset + header.edgeCount * 2 * sizeof(std::int32_t));
+
+        stream.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        writePadding(stream, sizeof(header), header.vertexOffset);
+        stream.write(reinterpret_cast<char const*>(positions.data()), static_cast<std::streamsize>(positions.size() * sizeof(Vector3)));
+        writePadding(stream, header.vertexOffset + header.vertexCount * sizeof(Vector3), header.edgeOffset);
+        // std::pair has no guaranteed layout, copy it into a flat int32 buffer
+        std::vector<std::int32_t> edges(links.size() * 2);
+        for (std::size_t i = 0; i < links.size(); i++)
+        {
+            edges[i * 2 + 0] = links[i].first;
+            edges[i * 2 + 1] = links[i].second;
+        }
+        stream.write(reinterpret_cast<char const*>(edges.data()), static_cast<std::streamsize>(edges.size() * sizeof(std::int32_t)));
+        writePadding(stream, header.edgeOffset + edges.size() * sizeof(std::int32_t), header.size);
+        return header.size;
+    }
+
+    PathGraphView::PathGraphView(std::span<std::byte const> bytes) :
+        data{ bytes }
+    {
+        if (bytes.size() < sizeof(PathGraphFileHeader))
+        {
+            throw std::runtime_error{ "Not a binary PATHGRAPH!" };
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, pathGraphFileMagic, sizeof(header.magic)) != 0)
+        {
+            throw std::runtime_error{ "Not a binary PATHGRAPH!" };
+        }
+        if (header.version != pathGraphFileVersion)
+        {
+            throw std::runtime_error{ "Unsupported PATHGRAPH version " + std::to_string(header.version) };
+        }
+        std::uint64_t vertexBytes = header.vertexCount * sizeof(Vector3);
+        std::uint64_t edgeBytes = header.edgeCount * 2 * sizeof(std::int32_t);
+        if (header.vertexOffset % pathGraphFileAlignment != 0 or header.edgeOffset % pathGraphFileAlignment != 0 or
+            header.vertexOffset < sizeof(PathGraphFileHeader) or header.size > bytes.size() or
+            header.vertexOffset > header.size or vertexBytes > header.size - header.vertexOffset or
+            header.edgeOffset > header.size or edgeBytes > header.size - header.edgeOffset)
+        {
+            throw std::runtime_error{ "Corrupted PATHGRAPH!" };
+        }
+        data = bytes.first(header.size);
+    }
+
+    std::size_t PathGraphView::vertexCount() const noexcept
+    {
+        return static_cast<std::size_t>(header.vertexCount);
+    }
+
+    std::size_t PathGraphView::edgeCount() const noexcept
+    {
+        return static_cast<std::size_t>(header.edgeCount);
+    }
+
+    std::span<Vector3 const> PathGraphView::vertices() const noexcept
+    {
+        return { reinterpret_cast<Vector3 const*>(data.data() + header.vertexOffset), vertexCount() };
+    }
+
+    std::span<std::int32_t const> PathGraphView::edges() const noexcept
+    {
+        return { reinterpret_cast<std::int32_t const*>(data.data() + header.edgeOffset), edgeCount() * 2 };
+    }
+
+    std::span<std::byte const> PathGraphView::bytes() const noexcept
+    {
+        return data;
+    }
+
+    PathGraphFile::PathGraphFile(std::string const& path) :
+        graph{ map(path, file) }
+    {}
+
+    PathGraphView const& PathGraphFile::view() const noexcept
+    {
+        return graph;
+    }
+
+    std::span<std::byte const> PathGraphFile::map(std::string const& path, decltype(file)& file)
+    {
+        file.open(path);
+        return { static_cast<std::byte const*>(file.data), file.size };
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef PATHGRAPH_FILE_HPP
+#define PATHGRAPH_FILE_HPP
+
+#include "Vector3.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include "Windows/MappedFile.hpp"
+#else
+#include "Unix/MappedFile.hpp"
+#endif // _WIN32
+
+namespace GraphGenerator
+{
+    // Binary PATHGRAPH file, little endian:
+    // [header, 64 bytes][float32 vertices[vertexCount][3]][int32 edges[edgeCount][2]]
+    // Both blocks start at a multiple of pathGraphFileAlignment, so they can be memory mapped
+    // and used in place (numpy.memmap, torch.from_file, ...).
+    struct PathGraphFileHeader
+    {
+        char magic[12];
+        std::uint32_t version;
+        std::uint64_t vertexCount;
+        std::uint64_t edgeCount;
+        std::uint64_t vertexOffset;  // in bytes, from the beginning of the header
+        std::uint64_t edgeOffset;  // in bytes, from the beginning of the header
+        std::uint64_t size;  // in bytes, header + blocks + padding
+        std::uint64_t reserved;
+    };
+    static_assert(sizeof(PathGraphFileHeader) == 64);
+
+    inline constexpr char pathGraphFileMagic[12] = "PATHGRAPH";
+    inline constexpr std::uint32_t pathGraphFileVersion = 1;
+    inline constexpr std::size_t pathGraphFileAlignment = 64;
+
+    // Writes the text format: "PATHGRAPH", "<V> <E>", V lines of positions, E lines of links
+    void writePathGraphText(std::ostream& stream, std::vector<Vector3> const& positions, std::vector<std::pair<int, int>> const& links);
+    class PathGraphView;
+    // Renders a binary PATHGRAPH as text, identical to writing the original positions and links
+    void writePathGraphText(std::ostream& stream, PathGraphView const& graph);
+    // Writes the binary format, returns the number of bytes written
+    std::uint64_t writePathGraphBinary(std::ostream& stream, std::vector<Vector3> const& positions, std::vector<std::pair<int, int>> const& links);
+
+    // Zero copy view of a binary PATHGRAPH
+    class PathGraphView
+    {
+    public:
+        // Validates the header and the block ranges, throws std::runtime_error if invalid
+        explicit PathGraphView(std::span<std::byte const> bytes);
+
+        std::size_t vertexCount() const noexcept;
+        std::size_t edgeCount() const noexcept;
+        std::span<Vector3 const> vertices() const noexcept;
+        // 2 entries per edge
+        std::span<std::int32_t const> edges() const noexcept;
+        std::span<std::byte const> bytes() const noexcept;
+
+    private:
+        std::span<std::byte const> data;
+        PathGraphFileHeader header;
+    };
+
+    // Memory mapped binary PATHGRAPH file
+    class PathGraphFile
+    {
+    public:
+        explicit PathGraphFile(std::string const& path);
+
+        PathGraphView const& view() const noexcept;
+
+    private:
+#ifdef _WIN32
+        Windows::MappedFile file;
+#else
+        Unix::MappedFile file;
+#endif // _WIN32
+        PathGraphView graph;
+
+        static std::span<std::byte const> map(std::string const& path, decltype(file)& file);
+    };
+}
+
+#endif // !PATHGRAPH_FILE_HPP
@@ -1,7 +1,10 @@
 #include "PathGraphInterface.hpp"
+#include "OctreeSnapshot.hpp"
 #include "PathGraph.hpp"
 #include "Windows/MonotonicAllocator.hpp"
+#include <algorithm>
 #include <memory>
+#include <stdexcept>
 
 #include "Octree.ipp"
 #include "PathGraph.ipp"
@@ -11,6 +14,39 @@ namespace GraphGenerator
     template<typename T>
     using Allocate = T * (int numberOfElements);
 
+    namespace
+    {
+        using MemoryPoolOctree = Octree<Windows::MonotonicAllocator<void>>;
+        using CompactMemoryPoolOctree = Octree<Windows::MonotonicAllocator<void>, CompactNodes>;
+        static_assert(sizeof(CompactMemoryPoolOctree::OctreeNode) != sizeof(MemoryPoolOctree::OctreeNode),
+            "loadPathGraph tells the node layouts apart by their size");
+    }
+
+    NodeArena::NodeArena() :
+        state{ MemoryPoolOctree::NodeAllocator{}.state }
+    {}
+
+    NodeArena::~NodeArena() = default;
+
+    std::size_t NodeArena::highWaterMark() const
+    {
+        return std::max(state->highWaterMark, state->usedBytes());
+    }
+
+    std::size_t NodeArena::committedBytes() const
+    {
+        return state->committedBytes();
+    }
+
+    void NodeArena::trim(std::size_t keepBytes)
+    {
+        if (state.use_count() != 1)
+        {
+            throw std::logic_error{ "node arena is in use" };
+        }
+        state->trim(keepBytes);
+    }
+
     IPathGraph* makePathGraph(float size, float radius, int minLayer) 
     {
         using OctreeType = Octree<std::allocator<void>>;
@@ -18,11 +54,43 @@ namespace GraphGenerator
     }
     IPathGraph* makePathGraphWithMemoryPool(float size, float radius, int minLayer)
     {
-        using OctreeType = Octree<Windows::MonotonicAllocator<void>>;
-        OctreeType::NodeAllocator allocator{ 48 * 1024 * 1024 };
-        PathGraph<OctreeType>* pointer = new PathGraph<OctreeType>{ size, radius, minLayer, std::move(allocator) };
+        // The octree reserves memory for an estimate of its nodes once it gets the triangles, and more if it outgrows it
+        MemoryPoolOctree::NodeAllocator allocator{};
+        PathGraph<MemoryPoolOctree>* pointer = new PathGraph<MemoryPoolOctree>{ size, radius, minLayer, std::move(allocator) };
         return pointer;
     }
+    IPathGraph* makePathGraphWithMemoryPool(float size, float radius, int minLayer, NodeArena& arena)
+    {
+        // The graph and the sub arenas of a parallel build hold the only other references
+        if (arena.state.use_count() != 1)
+        {
+            throw std::logic_error{ "node arena is in use" };
+        }
+        arena.state->reset();
+        return new PathGraph<MemoryPoolOctree>{ size, radius, minLayer, MemoryPoolOctree::NodeAllocator{ arena.state } };
+    }
+    IPathGraph* makeCompactPathGraphWithMemoryPool(float size, float radius, int minLayer)
+    {
+        return new PathGraph<CompactMemoryPoolOctree>{ size, radius, minLayer, CompactMemoryPoolOctree::NodeAllocator{} };
+    }
+    IPathGraph* makeCompactPathGraphWithMemoryPool(float size, float radius, int minLayer, NodeArena& arena)
+    {
+        if (arena.state.use_count() != 1)
+        {
+            throw std::logic_error{ "node arena is in use" };
+        }
+        arena.state->reset();
+        return new PathGraph<CompactMemoryPoolOctree>{ size, radius, minLayer, CompactMemoryPoolOctree::NodeAllocator{ arena.state } };
+    }
+    IPathGraph* loadPathGraph(std::string const& path)
+    {
+        // The node size tells the layouts apart
+        if (OctreeSnapshotFile{ path }.header().nodeSize == sizeof(CompactMemoryPoolOctree::OctreeNode))
+        {
+            return new PathGraph<CompactMemoryPoolOctree>{ path };
+        }
+        return new PathGraph<MemoryPoolOctree>{ path };
+    }
     void destroyPathGraph(IPathGraph* p) { return delete p; }
     void addTerrainTriangleMesh(IPathGraph* p, Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
         int maxLayer, bool considerRadius)
@@ -58,6 +126,8 @@ namespace GraphGenerator
     int samplePosition(IPathGraph* p, Vector3 position, float radius, int scc, Vector3& result) { return p->samplePosition(position, radius, scc, result); }
     int getComponentTotalCount(IPathGraph* p) { return p->getComponentTotalCount(); }
     int getComponentSize(IPathGraph* p, int index) { return p->getComponentSize(index); }
+    int getComponentEdgeCount(IPathGraph* p, int index) { return p->getComponentEdgeCount(index); }
+    int getLargestComponent(IPathGraph* p) { return p->getLargestComponent(); }
     std::pair<std::vector<Vector3>, std::vector<std::pair<int, int>>> getComponentGraph(IPathGraph* p, int index, bool rotate) { return p->getComponentGraph(index, rotate); }
     std::vector<std::vector<Vector3>> getComponentColorGraph(IPathGraph* p, int index, int layer) { return p->getComponentColorGraph(index, layer); }
     //std::vector<std::vector<Vector3>> getComponentGridGraph(IPathGraph* p, int index, int size) { return p->getComponentGridGraph(index, size); }
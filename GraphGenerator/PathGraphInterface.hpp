@@ -1,11 +1,21 @@
 #ifndef PATHGRAPH_INTERFACE_HPP
 #define PATHGRAPH_INTERFACE_HPP
 #include "Vector3.hpp"
+#include <cstddef>
 #include <list>
+#include <memory>
+#include <span>
+#include <string>
 #include <vector>
 
 namespace GraphGenerator
 {
+    class ThreadPool;
+    namespace Windows
+    {
+        struct MonotonicAllocatorState;
+    }
+
     class IPathGraph
     {
     public:
@@ -13,22 +23,88 @@ namespace GraphGenerator
 
         virtual void addTerrainTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
             int maxLayer, bool considerRadius) = 0;
+        // indices holds 3 vertex indices per triangle
+        // With a pool the octree is built in parallel, with the same result
+        virtual void addTerrainTriangleArrayMesh(std::span<Vector3 const> vertices, std::span<int const> indices,
+            int maxLayer, bool considerRadius, ThreadPool* pool = nullptr) = 0;
         virtual void addRuntimeTriangleMesh(Vector3 const& point1, Vector3 const& point2, Vector3 const& point3,
             int maxLayer, bool considerRadius, int runtimeMeshIndex) = 0;
         virtual void removeRuntimeMesh(int runtimeMeshIndex) = 0;
-        virtual void calculateTerrainPathGraph() = 0;
+        // Most nodes the octree may have while meshes are added, unlimited by default. Cells that would need more
+        // stay blocked leaves instead of failing. addTerrainTriangleArrayMesh without considerRadius keeps refining the cells
+        // that gain the most free space, the other calls refine in the order of their triangles until the budget is used up.
+        virtual void setNodeBudget(std::size_t nodes) = 0;
+        // Derives the octree of a coarser maxLayer from the current one, call calculateTerrainPathGraph afterwards
+        virtual void collapseToLayer(int layer) = 0;
+        // Keeps the terrain triangles added afterwards with the leaves they overlap, so refineTo can go deeper without adding them again.
+        // Turn it on before the first mesh, terrain meshes without considerRadius only, throws std::logic_error otherwise.
+        virtual void setRefinable(bool refinable) = 0;
+        // Splits the occupied leaves into the octree of a deeper maxLayer. A calculated path graph is updated around them,
+        // like calculateRuntimePathGraph does, the components are numbered again if most of them changed.
+        // Throws std::logic_error if the graph is not refinable or has runtime meshes.
+        virtual void refineTo(int layer) = 0;
+        // With a pool the components are found in parallel, with the same numbering
+        virtual void calculateTerrainPathGraph(ThreadPool* pool = nullptr) = 0;
+        // Only relabels the components around the changed nodes, see getComponentTotalCount
         virtual void calculateRuntimePathGraph() = 0;
+        // Writes a snapshot that loadPathGraph maps back without rebuilding anything, the graph itself is left as it is.
+        // Only for graphs with a memory pool after calculateTerrainPathGraph, without runtime meshes, throws std::logic_error otherwise.
+        virtual void save(std::string const& path) = 0;
+        // Independent copy of the graph, runtime meshes included, for trying changes on a graph that was built once.
+        // Costs a copy of the node memory. Only for graphs with a memory pool, throws std::logic_error otherwise.
+        virtual IPathGraph* clone() = 0;
+        // The octree as a sparse voxel DAG that stores every distinct subtree once, in the OCTDAG format of OctreeDag.hpp.
+        // OctreeDagView answers occupancy and neighbor queries on it directly, writeOctreeDag and OctreeDagFile put it on disk.
+        // Throws std::logic_error while the graph has runtime meshes.
+        virtual std::vector<std::byte> compressToDag() = 0;
         virtual int samplePosition(Vector3 position, float radius, int scc, Vector3& result) = 0;
+        // Components keep their numbers across calculateRuntimePathGraph, one that disappeared is left empty
+        // until a new component takes its number. calculateTerrainPathGraph numbers them in leaf order again.
         virtual int getComponentTotalCount() = 0;
         virtual int getComponentSize(int index) = 0;
+        virtual int getComponentEdgeCount(int index) = 0;
+        // The component with the most nodes, the first of them on a tie, 0 without components
+        virtual int getLargestComponent() = 0;
         virtual std::pair<std::vector<Vector3>, std::vector<std::pair<int, int>>> getComponentGraph(int index, bool rotate) = 0;
         virtual std::vector<std::vector<Vector3>> getComponentColorGraph(int index, int layer) = 0;
         //virtual std::vector<std::vector<Vector3>> getComponentGridGraph(int index, int size) = 0;
         //virtual std::vector<std::vector<Vector3>> getComponentGridRotatedGraph(int index, int size) = 0;
     };
 
+    // Node memory that is handed from one graph to the next, so its pages are committed once for many models.
+    // Only one graph at a time can use an arena.
+    class NodeArena
+    {
+    public:
+        NodeArena();
+        ~NodeArena();
+        NodeArena(NodeArena const&) = delete;
+        NodeArena& operator=(NodeArena const&) = delete;
+
+        // Most bytes a graph of this arena has used so far
+        std::size_t highWaterMark() const;
+        std::size_t committedBytes() const;
+        // Gives the physical pages after the first keepBytes back to the system, the arena stays usable
+        void trim(std::size_t keepBytes);
+
+    private:
+        friend IPathGraph* makePathGraphWithMemoryPool(float size, float radius, int minLayer, NodeArena& arena);
+        friend IPathGraph* makeCompactPathGraphWithMemoryPool(float size, float radius, int minLayer, NodeArena& arena);
+        std::shared_ptr<Windows::MonotonicAllocatorState> state;
+    };
+
     IPathGraph* makePathGraph(float size, float radius, int minLayer);
     IPathGraph* makePathGraphWithMemoryPool(float size, float radius, int minLayer);
+    // Resets the arena and builds the graph in it, throws std::logic_error while another graph still uses it
+    IPathGraph* makePathGraphWithMemoryPool(float size, float radius, int minLayer, NodeArena& arena);
+    // Graph with a memory pool of compact nodes, see CompactNodes in Octree.hpp. Same results in about half the memory,
+    // queries are slower because centers and parents are derived from the cells.
+    IPathGraph* makeCompactPathGraphWithMemoryPool(float size, float radius, int minLayer);
+    // Same as makePathGraphWithMemoryPool with an arena
+    IPathGraph* makeCompactPathGraphWithMemoryPool(float size, float radius, int minLayer, NodeArena& arena);
+    // Graph with a memory pool from a snapshot of IPathGraph::save, written by the same build.
+    // Throws std::runtime_error if the snapshot is invalid.
+    IPathGraph* loadPathGraph(std::string const& path);
     void destroyPathGraph(IPathGraph* p);
 }
 
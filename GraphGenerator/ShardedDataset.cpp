@@ -0,0 +1,143 @@
+#include "ShardedDataset.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+namespace GraphGenerator
+{
+    std::filesystem::path shardFileName(std::uint32_t shard)
+    {
+        char name[32] = {};
+        std::snprintf(name, sizeof(name), "pathgraph-%05u.shard", shard);
+        return name;
+    }
+
+    ShardWriter::ShardWriter(std::filesystem::path directory, std::uint64_t maxShardBytes) :
+        directory{ std::move(directory) },
+        maxShardBytes{ maxShardBytes }
+    {
+        std::filesystem::create_directories(this->directory);
+    }
+
+    void ShardWriter::append(std::size_t position, std::string objectId, std::string label, std::string split, std::span<std::byte const> bytes)
+    {
+        PathGraphView graph{ bytes };
+        auto const lock = std::scoped_lock{ mutex };
+        if (current.is_open() and currentSize + bytes.size() > maxShardBytes)
+        {
+            current.close();
+            currentShard++;
+            currentSize = 0;
+        }
+        if (not current.is_open())
+        {
+            current.open(directory / shardFileName(currentShard), std::ios::binary | std::ios::trunc);
+            if (not current)
+            {
+                throw std::runtime_error{ "Cannot create " + (directory / shardFileName(currentShard)).string() };
+            }
+        }
+        current.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        records.push_back({ position, ShardRecord{
+            .objectId = std::move(objectId),
+            .label = std::move(label),
+            .split = std::move(split),
+            .shard = currentShard,
+            .offset = currentSize,
+            .size = bytes.size(),
+            .vertexCount = graph.vertexCount(),
+            .edgeCount = graph.edgeCount() } });
+        currentSize += bytes.size();
+    }
+
+    void ShardWriter::finish()
+    {
+        auto const lock = std::scoped_lock{ mutex };
+        if (current.is_open())
+        {
+            current.close();
+        }
+        std::sort(records.begin(), records.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+        auto index = std::ofstream(directory / shardIndexFileName);
+        index << "object_id,class,split,shard,offset,size,vertex_count,edge_count" << std::endl;
+        for (auto& [position, record] : records)
+        {
+            index << record.objectId << "," << record.label << "," << record.split << "," << record.shard << ","
+                << record.offset << "," << record.size << "," << record.vertexCount << "," << record.edgeCount << "\n";
+        }
+        if (not index)
+        {
+            throw std::runtime_error{ "Cannot write " + (directory / shardIndexFileName).string() };
+        }
+    }
+
+    ShardedDataset::ShardedDataset(std::filesystem::path const& directory)
+    {
+        auto file = std::ifstream(directory / shardIndexFileName);
+        if (not file)
+        {
+            throw std::runtime_error{ "Cannot read " + (directory / shardIndexFileName).string() };
+        }
+        std::string line;
+        // header
+        std::getline(file, line);
+        std::uint32_t shardCount = 0;
+        while (std::getline(file, line))
+        {
+            if (line.empty())
+            {
+                continue;
+            }
+            std::vector<std::string> cells;
+            std::string cell;
+            auto stream = std::istringstream(line);
+            while (std::getline(stream, cell, ','))
+            {
+                cells.push_back(cell);
+            }
+            if (cells.size() != 8)
+            {
+                throw std::runtime_error{ "Corrupted shard index line: " + line };
+            }
+            ShardRecord record{
+                .objectId = cells[0],
+                .label = cells[1],
+                .split = cells[2],
+                .shard = static_cast<std::uint32_t>(std::stoul(cells[3])),
+                .offset = std::stoull(cells[4]),
+                .size = std::stoull(cells[5]),
+                .vertexCount = std::stoull(cells[6]),
+                .edgeCount = std::stoull(cells[7]) };
+            shardCount = std::max(shardCount, record.shard + 1);
+            lookup.insert({ record.objectId, index.size() });
+            index.push_back(std::move(record));
+        }
+        shards.resize(shardCount);
+        for (std::uint32_t i = 0; i < shardCount; i++)
+        {
+            shards[i].open((directory / shardFileName(i)).string());
+        }
+    }
+
+    std::vector<ShardRecord> const& ShardedDataset::records() const noexcept
+    {
+        return index;
+    }
+
+    PathGraphView ShardedDataset::get(std::string const& objectId) const
+    {
+        return get(index[lookup.at(objectId)]);
+    }
+
+    PathGraphView ShardedDataset::get(ShardRecord const& record) const
+    {
+        auto& shard = shards.at(record.shard);
+        if (record.offset > shard.size or record.size > shard.size - record.offset)
+        {
+            throw std::runtime_error{ "Corrupted shard record: " + record.objectId };
+        }
+        auto bytes = std::span{ static_cast<std::byte const*>(shard.data), shard.size };
+        return PathGraphView{ bytes.subspan(record.offset, record.size) };
+    }
+}
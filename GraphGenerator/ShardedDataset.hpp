@@ -0,0 +1,81 @@
+#ifndef SHARDED_DATASET_HPP
+#define SHARDED_DATASET_HPP
+
+#include "PathGraphFile.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace GraphGenerator
+{
+    // A baked dataset stored as a few large shard files instead of one small file per model.
+    // Every shard ("pathgraph-00000.shard", ...) is a concatenation of binary PATHGRAPH records,
+    // "index.csv" maps each object_id to its shard, offset and size:
+    // object_id,class,split,shard,offset,size,vertex_count,edge_count
+    struct ShardRecord
+    {
+        std::string objectId;
+        std::string label;  // "class" column
+        std::string split;
+        std::uint32_t shard = 0;
+        std::uint64_t offset = 0;  // in bytes, always a multiple of pathGraphFileAlignment
+        std::uint64_t size = 0;  // in bytes
+        std::uint64_t vertexCount = 0;
+        std::uint64_t edgeCount = 0;
+    };
+
+    inline constexpr char shardIndexFileName[] = "index.csv";
+    std::filesystem::path shardFileName(std::uint32_t shard);
+
+    // Appends records to shards, can be used from multiple threads
+    class ShardWriter
+    {
+    public:
+        // A new shard is started once the current one grows beyond maxShardBytes
+        ShardWriter(std::filesystem::path directory, std::uint64_t maxShardBytes);
+        ShardWriter(ShardWriter&&) = delete;
+
+        // bytes must be a complete binary PATHGRAPH, position is the place of the record inside the index
+        void append(std::size_t position, std::string objectId, std::string label, std::string split, std::span<std::byte const> bytes);
+        // Closes the current shard and writes the index, ordered by position
+        void finish();
+
+    private:
+        std::filesystem::path directory;
+        std::uint64_t maxShardBytes;
+        std::mutex mutex;
+        std::ofstream current;
+        std::uint32_t currentShard = 0;
+        std::uint64_t currentSize = 0;
+        std::vector<std::pair<std::size_t, ShardRecord>> records;
+    };
+
+    // Random access to a sharded dataset, every shard is memory mapped once when the dataset is opened
+    class ShardedDataset
+    {
+    public:
+        explicit ShardedDataset(std::filesystem::path const& directory);
+
+        std::vector<ShardRecord> const& records() const noexcept;
+        // Throws std::out_of_range if the object is not part of the dataset
+        PathGraphView get(std::string const& objectId) const;
+        PathGraphView get(ShardRecord const& record) const;
+
+    private:
+        std::vector<ShardRecord> index;
+        std::unordered_map<std::string, std::size_t> lookup;
+#ifdef _WIN32
+        std::vector<Windows::MappedFile> shards;
+#else
+        std::vector<Unix::MappedFile> shards;
+#endif // _WIN32
+    };
+}
+
+#endif // !SHARDED_DATASET_HPP
@@ -0,0 +1,197 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace GraphGenerator
+{
+    namespace
+    {
+        // Which pool (if any) the current thread is a worker of, and its index inside the pool
+        thread_local ThreadPool const* currentPool = nullptr;
+        thread_local unsigned int currentWorker = 0;
+    }
+
+    ThreadPool::ThreadPool(unsigned int threadCount)
+    {
+        threadCount = std::max(threadCount, 1U);
+        workers.reserve(threadCount);
+        for (unsigned int i = 0; i < threadCount; i++)
+        {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        threads.reserve(threadCount);
+        for (unsigned int i = 0; i < threadCount; i++)
+        {
+            threads.emplace_back([this, i] { run(i); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            auto const lock = std::scoped_lock{ sleepMutex };
+            stopping = true;
+        }
+        sleepCondition.notify_all();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    unsigned int ThreadPool::size() const noexcept
+    {
+        return static_cast<unsigned int>(workers.size());
+    }
+
+    void ThreadPool::submit(Task task)
+    {
+        unsigned int target = currentPool == this ? currentWorker : nextWorker++ % size();
+        ++pendingTasks;
+        {
+            auto const lock = std::scoped_lock{ workers[target]->mutex };
+            workers[target]->tasks.push_back(std::move(task));
+        }
+        {
+            // Lock before notify, otherwise a worker which just checked pendingTasks might miss the wake up
+            auto const lock = std::scoped_lock{ sleepMutex };
+        }
+        sleepCondition.notify_one();
+    }
+
+    bool ThreadPool::popOrSteal(unsigned int self, Task& task)
+    {
+        if (pendingTasks == 0)
+        {
+            return false;
+        }
+        {
+            Worker& own = *workers[self];
+            auto const lock = std::scoped_lock{ own.mutex };
+            if (not own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                --pendingTasks;
+                return true;
+            }
+        }
+        for (unsigned int i = 1; i < size(); i++)
+        {
+            Worker& victim = *workers[(self + i) % size()];
+            auto const lock = std::scoped_lock{ victim.mutex };
+            if (not victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                --pendingTasks;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::run(unsigned int self)
+    {
+        currentPool = this;
+        currentWorker = self;
+        while (true)
+        {
+            Task task;
+            if (popOrSteal(self, task))
+            {
+                task();
+                continue;
+            }
+            auto lock = std::unique_lock{ sleepMutex };
+            sleepCondition.wait(lock, [this] { return stopping or pendingTasks != 0; });
+            if (stopping and pendingTasks == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    TaskGroup::TaskGroup(ThreadPool& pool) :
+        pool{ pool },
+        state{ std::make_shared<State>() }
+    {}
+
+    TaskGroup::~TaskGroup()
+    {
+        // Tasks reference the caller, never leave them running
+        waitForTasks();
+    }
+
+    void TaskGroup::run(ThreadPool::Task task)
+    {
+        {
+            auto const lock = std::scoped_lock{ state->mutex };
+            state->tasks.push_back(std::move(task));
+            state->remaining++;
+        }
+        state->changed.notify_all();
+        pool.submit([state = state] { runPendingTask(*state); });
+    }
+
+    void TaskGroup::wait()
+    {
+        waitForTasks();
+        if (state->exception != nullptr)
+        {
+            std::rethrow_exception(std::exchange(state->exception, nullptr));
+        }
+    }
+
+    void TaskGroup::runPendingTask(State& state)
+    {
+        auto lock = std::unique_lock{ state.mutex };
+        if (not state.tasks.empty())
+        {
+            runTask(state, lock);
+        }
+    }
+
+    void TaskGroup::runTask(State& state, std::unique_lock<std::mutex>& lock)
+    {
+        ThreadPool::Task task = std::move(state.tasks.front());
+        state.tasks.pop_front();
+        lock.unlock();
+        std::exception_ptr exception = nullptr;
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        lock.lock();
+        if (state.exception == nullptr)
+        {
+            state.exception = exception;
+        }
+        if (--state.remaining == 0)
+        {
+            state.changed.notify_all();
+        }
+    }
+
+    void TaskGroup::waitForTasks()
+    {
+        // Only help with the tasks of this group, the one we are waiting for might be queued behind us
+        bool helping = currentPool == &pool;
+        auto lock = std::unique_lock{ state->mutex };
+        while (state->remaining != 0)
+        {
+            if (helping and not state->tasks.empty())
+            {
+                runTask(*state, lock);
+            }
+            else
+            {
+                state->changed.wait(lock);
+            }
+        }
+    }
+}
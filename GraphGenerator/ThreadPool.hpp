@@ -0,0 +1,91 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GraphGenerator
+{
+    // A small thread pool.
+    // Tasks are submitted through a TaskGroup, which keeps them in its own FIFO queue and only hands the pool
+    // interchangeable runners that take the next task of the group. The runners are spread over one deque per worker,
+    // so submitting and taking them rarely contend on one lock, and an idle worker takes them from the other deques.
+    class ThreadPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+        ThreadPool(ThreadPool&&) = delete;
+        ~ThreadPool();
+
+        unsigned int size() const noexcept;
+        // Pushes to the deque of the calling worker, or round robin if called from outside of the pool.
+        void submit(Task task);
+
+    private:
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> threads;
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition;
+        std::atomic<std::size_t> pendingTasks = 0;
+        std::atomic<unsigned int> nextWorker = 0;
+        bool stopping = false;
+
+        bool popOrSteal(unsigned int self, Task& task);
+        void run(unsigned int self);
+    };
+
+    // Tracks a set of tasks submitted to a ThreadPool.
+    // The tasks wait in a queue of the group, the pool only gets runners that take the next one from it.
+    // wait() executes tasks of this group on the calling worker instead of blocking, so it is safe to wait for a group
+    // from inside another task (nested parallelism), and a waiting task never picks up unrelated work.
+    // Once none are left to take it blocks until the running ones finish. Threads outside of the pool only block.
+    class TaskGroup
+    {
+    public:
+        explicit TaskGroup(ThreadPool& pool);
+        TaskGroup(TaskGroup&&) = delete;
+        ~TaskGroup();
+
+        void run(ThreadPool::Task task);
+        // Rethrows the first exception thrown by any task of the group.
+        void wait();
+
+    private:
+        // Shared with the runners, which may outlive the group once wait() took their tasks
+        struct State
+        {
+            std::mutex mutex;
+            // Signalled when a task is added and when the last one finishes
+            std::condition_variable changed;
+            std::deque<ThreadPool::Task> tasks;
+            std::size_t remaining = 0;  // added but not finished yet
+            std::exception_ptr exception = nullptr;
+        };
+
+        ThreadPool& pool;
+        std::shared_ptr<State> state;
+
+        // Runs the oldest task of the group, does nothing if all of them were taken already.
+        static void runPendingTask(State& state);
+        // Runs a task taken from the queue and marks it as finished, lock is held before and after
+        static void runTask(State& state, std::unique_lock<std::mutex>& lock);
+        void waitForTasks();
+    };
+}
+
+#endif // !THREAD_POOL_HPP
@@ -0,0 +1,206 @@
+#include "TriangleBoxOverlap.hpp"
+#include "TriangleBoxOverlapLanes.hpp"
+#include <algorithm>
+#include <cmath>
+#if defined(__x86_64__) || defined(_M_X64)
+#define GRAPH_GENERATOR_X64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+#endif // __x86_64__ || _M_X64
+
+namespace GraphGenerator
+{
+    namespace
+    {
+        using Detail::TriangleBoxLanes;
+
+#ifdef GRAPH_GENERATOR_X64
+        // SSE is part of x86-64, no detection needed
+        struct SsePack
+        {
+            using Type = __m128;
+            static int constexpr width = 4;
+
+            static __m128 load(float const* p) { return _mm_load_ps(p); }
+            static __m128 set(float value) { return _mm_set1_ps(value); }
+            static __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+            static __m128 sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+            static __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+            static __m128 min(__m128 a, __m128 b) { return _mm_min_ps(a, b); }
+            static __m128 max(__m128 a, __m128 b) { return _mm_max_ps(a, b); }
+            static __m128 negate(__m128 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+            static __m128 abs(__m128 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+            static __m128 greater(__m128 a, __m128 b) { return _mm_cmpgt_ps(a, b); }
+            static __m128 greaterEqual(__m128 a, __m128 b) { return _mm_cmpge_ps(a, b); }
+            static __m128 less(__m128 a, __m128 b) { return _mm_cmplt_ps(a, b); }
+            static __m128 lessEqual(__m128 a, __m128 b) { return _mm_cmple_ps(a, b); }
+            static __m128 orMask(__m128 a, __m128 b) { return _mm_or_ps(a, b); }
+            static unsigned int bits(__m128 mask) { return static_cast<unsigned int>(_mm_movemask_ps(mask)); }
+        };
+
+        bool detectAvx() noexcept
+        {
+#ifdef _MSC_VER
+            int info[4] = {};
+            __cpuid(info, 1);
+            bool osSavesAvx = (info[2] & (1 << 27)) != 0 and (_xgetbv(0) & 6) == 6;
+            return osSavesAvx and (info[2] & (1 << 28)) != 0;
+#else
+            return __builtin_cpu_supports("avx");
+#endif // _MSC_VER
+        }
+
+        bool const hasAvx = detectAvx();
+#endif // GRAPH_GENERATOR_X64
+
+        unsigned int overlapLanes(TriangleBoxLanes const& lanes)
+        {
+#ifdef GRAPH_GENERATOR_X64
+            if (hasAvx)
+            {
+                return Detail::overlapLanesAvx(lanes);
+            }
+            return Detail::overlapLanes<SsePack>(lanes);
+#else
+            unsigned int result = 0;
+            for (int i = 0; i < lanes.count; i++)
+            {
+                Vector3 center{ .x = lanes.centerX[i], .y = lanes.centerY[i], .z = lanes.centerZ[i] };
+                if (triangleBoxOverlap(center, lanes.halfSize,
+                    Vector3{ .x = lanes.point1X[i], .y = lanes.point1Y[i], .z = lanes.point1Z[i] },
+                    Vector3{ .x = lanes.point2X[i], .y = lanes.point2Y[i], .z = lanes.point2Z[i] },
+                    Vector3{ .x = lanes.point3X[i], .y = lanes.point3Y[i], .z = lanes.point3Z[i] }))
+                {
+                    result |= 1u << i;
+                }
+            }
+            return result;
+#endif // GRAPH_GENERATOR_X64
+        }
+
+        void setTriangle(TriangleBoxLanes& lanes, int lane, Vector3 const& point1, Vector3 const& point2, Vector3 const& point3)
+        {
+            lanes.point1X[lane] = point1.x;
+            lanes.point1Y[lane] = point1.y;
+            lanes.point1Z[lane] = point1.z;
+            lanes.point2X[lane] = point2.x;
+            lanes.point2Y[lane] = point2.y;
+            lanes.point2Z[lane] = point2.z;
+            lanes.point3X[lane] = point3.x;
+            lanes.point3Y[lane] = point3.y;
+            lanes.point3Z[lane] = point3.z;
+        }
+    }
+
+    bool triangleBoxOverlap(Vector3 const& center, float halfSize, Vector3 point1, Vector3 point2, Vector3 point3)
+    {
+        float r = halfSize;
+        point1 = point1 - center;
+        point2 = point2 - center;
+        point3 = point3 - center;
+        if (std::min(point1.x, std::min(point2.x, point3.x)) >= r ||
+            std::max(point1.x, std::max(point2.x, point3.x)) <= -r ||
+            std::min(point1.y, std::min(point2.y, point3.y)) >= r ||
+            std::max(point1.y, std::max(point2.y, point3.y)) <= -r ||
+            std::min(point1.z, std::min(point2.z, point3.z)) >= r ||
+            std::max(point1.z, std::max(point2.z, point3.z)) <= -r)
+        {
+            return false;
+        }
+
+        Vector3 n = cross(point2 - point1, point3 - point1);
+        if (std::abs(dot(point1, n)) > r * (std::abs(n.x) + std::abs(n.y) + std::abs(n.z)))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            // j = 0
+            Vector3 ai = Vector3{ .x = 0, .y = 0, .z = 0 };
+            ai[i] = 1;
+            Vector3 a = cross(ai, point3 - point2);
+            float d1 = dot(point1, a);
+            float d2 = dot(point2, a);
+            float rr = r * (std::abs(a[(i + 1) % 3]) + std::abs(a[(i + 2) % 3]));
+            if (std::min(d1, d2) > rr || std::max(d1, d2) < -rr)
+            {
+                return false;
+            }
+            // j = 1
+            a = cross(ai, point1 - point3);
+            d1 = dot(point2, a);
+            d2 = dot(point3, a);
+            rr = r * (std::abs(a[(i + 1) % 3]) + std::abs(a[(i + 2) % 3]));
+            if (std::min(d1, d2) > rr || std::max(d1, d2) < -rr)
+            {
+                return false;
+            }
+            // j = 2
+            a = cross(ai, point2 - point1);
+            d1 = dot(point3, a);
+            d2 = dot(point1, a);
+            rr = r * (std::abs(a[(i + 1) % 3]) + std::abs(a[(i + 2) % 3]));
+            if (std::min(d1, d2) > rr || std::max(d1, d2) < -rr)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    unsigned int triangleChildrenOverlap(Vector3 const& center, float childSize, float expansion,
+        Vector3 const& point1, Vector3 const& point2, Vector3 const& point3)
+    {
+        TriangleBoxLanes lanes;
+        lanes.halfSize = childSize + expansion;
+        lanes.count = 8;
+        for (int r = 0; r < 8; r++)
+        {
+            // Same as parent->centerPosition + size * cornerDirections[rx][ry][rz] in the OctreeNode constructor
+            lanes.centerX[r] = center.x + childSize * ((r & 4) ? -1.0f : 1.0f);
+            lanes.centerY[r] = center.y + childSize * ((r & 2) ? -1.0f : 1.0f);
+            lanes.centerZ[r] = center.z + childSize * ((r & 1) ? -1.0f : 1.0f);
+            setTriangle(lanes, r, point1, point2, point3);
+        }
+        return overlapLanes(lanes);
+    }
+
+    void appendTrianglesOverlappingBox(Vector3 const& center, float halfSize, std::span<Vector3 const> vertices,
+        std::span<int const> indices, std::span<int const> triangles, std::vector<int>& result)
+    {
+        TriangleBoxLanes lanes{};
+        lanes.halfSize = halfSize;
+        std::fill(std::begin(lanes.centerX), std::end(lanes.centerX), center.x);
+        std::fill(std::begin(lanes.centerY), std::end(lanes.centerY), center.y);
+        std::fill(std::begin(lanes.centerZ), std::end(lanes.centerZ), center.z);
+        for (std::size_t begin = 0; begin < triangles.size(); begin += TriangleBoxLanes::width)
+        {
+            lanes.count = static_cast<int>(std::min<std::size_t>(TriangleBoxLanes::width, triangles.size() - begin));
+            for (int lane = 0; lane < lanes.count; lane++)
+            {
+                int t = triangles[begin + lane];
+                setTriangle(lanes, lane, vertices[indices[t * 3 + 0]], vertices[indices[t * 3 + 1]], vertices[indices[t * 3 + 2]]);
+            }
+            unsigned int mask = overlapLanes(lanes);
+            for (int lane = 0; lane < lanes.count; lane++)
+            {
+                if (mask & (1u << lane))
+                {
+                    result.push_back(triangles[begin + lane]);
+                }
+            }
+        }
+    }
+
+    char const* triangleBoxOverlapKernel() noexcept
+    {
+#ifdef GRAPH_GENERATOR_X64
+        return hasAvx ? "avx" : "sse";
+#else
+        return "scalar";
+#endif // GRAPH_GENERATOR_X64
+    }
+}
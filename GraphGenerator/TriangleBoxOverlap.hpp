@@ -0,0 +1,28 @@
+#ifndef TRIANGLE_BOX_OVERLAP_HPP
+#define TRIANGLE_BOX_OVERLAP_HPP
+
+#include "Vector3.hpp"
+#include <span>
+#include <vector>
+
+namespace GraphGenerator
+{
+    // Separating axis test of a triangle against the box center ± halfSize.
+    // This is the scalar reference, the vectorized kernels below return exactly the same answers for finite input.
+    bool triangleBoxOverlap(Vector3 const& center, float halfSize, Vector3 point1, Vector3 point2, Vector3 point3);
+
+    // Tests one triangle against the eight children of the node at center in a single call.
+    // Children are childSize + expansion large, bit r of the result is set if it overlaps child r = 4 * rx + 2 * ry + rz,
+    // child centers are computed like the OctreeNode constructor does.
+    unsigned int triangleChildrenOverlap(Vector3 const& center, float childSize, float expansion,
+        Vector3 const& point1, Vector3 const& point2, Vector3 const& point3);
+
+    // Appends the triangles (3 entries of indices per triangle) that overlap the box center ± halfSize to result, in order.
+    void appendTrianglesOverlappingBox(Vector3 const& center, float halfSize, std::span<Vector3 const> vertices,
+        std::span<int const> indices, std::span<int const> triangles, std::vector<int>& result);
+
+    // "avx", "sse" or "scalar", whichever the functions above picked on this CPU
+    char const* triangleBoxOverlapKernel() noexcept;
+}
+
+#endif // !TRIANGLE_BOX_OVERLAP_HPP
@@ -0,0 +1,38 @@
+// Compiled with AVX enabled, only called after TriangleBoxOverlap.cpp checked that the CPU supports it
+#include "TriangleBoxOverlapLanes.hpp"
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+
+namespace GraphGenerator::Detail
+{
+    namespace
+    {
+        struct AvxPack
+        {
+            using Type = __m256;
+            static int constexpr width = 8;
+
+            static __m256 load(float const* p) { return _mm256_load_ps(p); }
+            static __m256 set(float value) { return _mm256_set1_ps(value); }
+            static __m256 add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+            static __m256 sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+            static __m256 mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+            static __m256 min(__m256 a, __m256 b) { return _mm256_min_ps(a, b); }
+            static __m256 max(__m256 a, __m256 b) { return _mm256_max_ps(a, b); }
+            static __m256 negate(__m256 a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+            static __m256 abs(__m256 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+            static __m256 greater(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+            static __m256 greaterEqual(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+            static __m256 less(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+            static __m256 lessEqual(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+            static __m256 orMask(__m256 a, __m256 b) { return _mm256_or_ps(a, b); }
+            static unsigned int bits(__m256 mask) { return static_cast<unsigned int>(_mm256_movemask_ps(mask)); }
+        };
+    }
+
+    unsigned int overlapLanesAvx(TriangleBoxLanes const& lanes)
+    {
+        return overlapLanes<AvxPack>(lanes);
+    }
+}
+#endif // __x86_64__ || _M_X64
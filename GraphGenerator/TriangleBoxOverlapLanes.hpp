@@ -0,0 +1,110 @@
+#ifndef TRIANGLE_BOX_OVERLAP_LANES_HPP
+#define TRIANGLE_BOX_OVERLAP_LANES_HPP
+
+// Internal to TriangleBoxOverlap.cpp and TriangleBoxOverlapAvx.cpp, which compile overlapLanes with different instruction sets.
+// Nothing in here may call an inline function shared with other translation units,
+// the linker could otherwise keep the AVX copy of it for code running on CPUs without AVX.
+
+namespace GraphGenerator::Detail
+{
+    // Up to 8 triangle / box pairs, one per lane, structure of arrays so that a lane is one element of a register
+    struct TriangleBoxLanes
+    {
+        static int constexpr width = 8;
+
+        alignas(32) float centerX[width];
+        alignas(32) float centerY[width];
+        alignas(32) float centerZ[width];
+        alignas(32) float point1X[width];
+        alignas(32) float point1Y[width];
+        alignas(32) float point1Z[width];
+        alignas(32) float point2X[width];
+        alignas(32) float point2Y[width];
+        alignas(32) float point2Z[width];
+        alignas(32) float point3X[width];
+        alignas(32) float point3Y[width];
+        alignas(32) float point3Z[width];
+        float halfSize;
+        int count;
+    };
+
+    unsigned int overlapLanesAvx(TriangleBoxLanes const& lanes);
+
+    // The scalar triangleBoxOverlap, written for a Pack of lanes.
+    // Every lane performs the same float operations in the same order, so results match the scalar version bit for bit.
+    // The zero components of the edge axes are left out, adding a signed zero to a finite number does not change it.
+    template<typename Pack>
+    unsigned int overlapLanes(TriangleBoxLanes const& lanes)
+    {
+        using V = typename Pack::Type;
+        unsigned int result = 0;
+        V r = Pack::set(lanes.halfSize);
+        V negativeR = Pack::negate(r);
+        for (int base = 0; base < lanes.count; base += Pack::width)
+        {
+            V centerX = Pack::load(lanes.centerX + base);
+            V centerY = Pack::load(lanes.centerY + base);
+            V centerZ = Pack::load(lanes.centerZ + base);
+            V p1x = Pack::sub(Pack::load(lanes.point1X + base), centerX);
+            V p1y = Pack::sub(Pack::load(lanes.point1Y + base), centerY);
+            V p1z = Pack::sub(Pack::load(lanes.point1Z + base), centerZ);
+            V p2x = Pack::sub(Pack::load(lanes.point2X + base), centerX);
+            V p2y = Pack::sub(Pack::load(lanes.point2Y + base), centerY);
+            V p2z = Pack::sub(Pack::load(lanes.point2Z + base), centerZ);
+            V p3x = Pack::sub(Pack::load(lanes.point3X + base), centerX);
+            V p3y = Pack::sub(Pack::load(lanes.point3Y + base), centerY);
+            V p3z = Pack::sub(Pack::load(lanes.point3Z + base), centerZ);
+
+            V rejected = Pack::orMask(
+                Pack::orMask(
+                    Pack::orMask(Pack::greaterEqual(Pack::min(p1x, Pack::min(p2x, p3x)), r), Pack::lessEqual(Pack::max(p1x, Pack::max(p2x, p3x)), negativeR)),
+                    Pack::orMask(Pack::greaterEqual(Pack::min(p1y, Pack::min(p2y, p3y)), r), Pack::lessEqual(Pack::max(p1y, Pack::max(p2y, p3y)), negativeR))),
+                Pack::orMask(Pack::greaterEqual(Pack::min(p1z, Pack::min(p2z, p3z)), r), Pack::lessEqual(Pack::max(p1z, Pack::max(p2z, p3z)), negativeR)));
+            unsigned int laneMask = (1u << (lanes.count - base < Pack::width ? lanes.count - base : Pack::width)) - 1;
+            if ((Pack::bits(rejected) & laneMask) == laneMask)
+            {
+                continue;
+            }
+
+            // Triangle plane
+            V e1x = Pack::sub(p2x, p1x);
+            V e1y = Pack::sub(p2y, p1y);
+            V e1z = Pack::sub(p2z, p1z);
+            V e2x = Pack::sub(p3x, p1x);
+            V e2y = Pack::sub(p3y, p1y);
+            V e2z = Pack::sub(p3z, p1z);
+            V nx = Pack::sub(Pack::mul(e1y, e2z), Pack::mul(e1z, e2y));
+            V ny = Pack::sub(Pack::mul(e1z, e2x), Pack::mul(e1x, e2z));
+            V nz = Pack::sub(Pack::mul(e1x, e2y), Pack::mul(e1y, e2x));
+            V distance = Pack::add(Pack::add(Pack::mul(p1x, nx), Pack::mul(p1y, ny)), Pack::mul(p1z, nz));
+            V extent = Pack::mul(r, Pack::add(Pack::add(Pack::abs(nx), Pack::abs(ny)), Pack::abs(nz)));
+            rejected = Pack::orMask(rejected, Pack::greater(Pack::abs(distance), extent));
+
+            // Axes cross(unit x, edge), cross(unit y, edge) and cross(unit z, edge) for every edge
+            auto edge = [&](V ex, V ey, V ez, V ax, V ay, V az, V bx, V by, V bz)
+            {
+                auto test = [&](V d1, V d2, V rr)
+                {
+                    rejected = Pack::orMask(rejected, Pack::orMask(Pack::greater(Pack::min(d1, d2), rr), Pack::less(Pack::max(d1, d2), Pack::negate(rr))));
+                };
+                V negativeEx = Pack::negate(ex);
+                V negativeEy = Pack::negate(ey);
+                V negativeEz = Pack::negate(ez);
+                test(Pack::add(Pack::mul(ay, negativeEz), Pack::mul(az, ey)), Pack::add(Pack::mul(by, negativeEz), Pack::mul(bz, ey)),
+                    Pack::mul(r, Pack::add(Pack::abs(negativeEz), Pack::abs(ey))));
+                test(Pack::add(Pack::mul(ax, ez), Pack::mul(az, negativeEx)), Pack::add(Pack::mul(bx, ez), Pack::mul(bz, negativeEx)),
+                    Pack::mul(r, Pack::add(Pack::abs(negativeEx), Pack::abs(ez))));
+                test(Pack::add(Pack::mul(ax, negativeEy), Pack::mul(ay, ex)), Pack::add(Pack::mul(bx, negativeEy), Pack::mul(by, ex)),
+                    Pack::mul(r, Pack::add(Pack::abs(negativeEy), Pack::abs(ex))));
+            };
+            edge(Pack::sub(p3x, p2x), Pack::sub(p3y, p2y), Pack::sub(p3z, p2z), p1x, p1y, p1z, p2x, p2y, p2z);
+            edge(Pack::sub(p1x, p3x), Pack::sub(p1y, p3y), Pack::sub(p1z, p3z), p2x, p2y, p2z, p3x, p3y, p3z);
+            edge(Pack::sub(p2x, p1x), Pack::sub(p2y, p1y), Pack::sub(p2z, p1z), p3x, p3y, p3z, p1x, p1y, p1z);
+
+            result |= (~Pack::bits(rejected) & laneMask) << base;
+        }
+        return result;
+    }
+}
+
+#endif // !TRIANGLE_BOX_OVERLAP_LANES_HPP
@@ -0,0 +1,72 @@
+#include "MappedFile.hpp"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace GraphGenerator::Unix
+{
+    MappedFile::~MappedFile()
+    {
+        if (data == nullptr)
+        {
+            return;
+        }
+        munmap(const_cast<void*>(data), size);
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        data = std::exchange(other.data, data);
+        size = std::exchange(other.size, size);
+        return *this;
+    }
+
+    void MappedFile::open(std::string const& path)
+    {
+        if (data != nullptr)
+        {
+            throw std::logic_error{ "file already mapped, MappedFile cannot be reused" };
+        }
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file == -1)
+        {
+            throw std::system_error{ errno, std::system_category(), "open " + path };
+        }
+        struct stat status = {};
+        if (fstat(file, &status) == -1)
+        {
+            int error = errno;
+            close(file);
+            throw std::system_error{ error, std::system_category(), "fstat " + path };
+        }
+        size = static_cast<std::size_t>(status.st_size);
+        if (size == 0)
+        {
+            // mmap does not accept empty ranges, an empty file is simply an empty view
+            close(file);
+            return;
+        }
+        void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        int error = errno;
+        close(file);
+        if (address == MAP_FAILED)
+        {
+            size = 0;
+            throw std::system_error{ error, std::system_category(), "mmap " + path };
+        }
+        // The file is read front to back exactly once
+        madvise(address, size, MADV_SEQUENTIAL);
+        data = address;
+    }
+}
+#endif // _WIN32
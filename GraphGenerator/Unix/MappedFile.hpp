@@ -0,0 +1,22 @@
+#ifndef UNIX_MAPPED_FILE_HPP
+#define UNIX_MAPPED_FILE_HPP
+#include <cstddef>
+#include <string>
+
+namespace GraphGenerator::Unix
+{
+    // Read only view of a whole file
+    struct MappedFile
+    {
+        void const* data = nullptr;
+        std::size_t size = 0;
+
+        MappedFile() = default;
+        ~MappedFile();
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&&) noexcept;
+        void open(std::string const& path);
+    };
+}
+
+#endif // UNIX_MAPPED_FILE_HPP
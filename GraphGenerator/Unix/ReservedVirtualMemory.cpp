@@ -1,10 +1,14 @@
 #include "ReservedVirtualMemory.hpp"
 #ifndef _WIN32
+#include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <limits>
 #include <stdexcept>
 #include <system_error>
+#include <utility>
 
 namespace GraphGenerator::Unix
 {
@@ -76,5 +80,47 @@ namespace GraphGenerator::Unix
         }
         currentEnd += bytes;
     }
+
+    void ReservedVirtualMemory::discard(std::uintptr_t address, std::size_t bytes)
+    {
+        // whole pages inside the range only
+        std::uintptr_t begin = ((address + pageSize - 1) / pageSize) * pageSize;
+        std::uintptr_t end = std::min(address + bytes, currentEnd) / pageSize * pageSize;
+        if (begin >= end)
+        {
+            return;
+        }
+        if (madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED) == -1)
+        {
+            throw std::system_error{ errno, std::system_category(), "madvise" };
+        }
+    }
+
+    void ReservedVirtualMemory::mapFile(std::string const& path, std::uint64_t offset, std::size_t bytes)
+    {
+        // round bytes to page size, the file has to cover the last page
+        bytes = (((bytes - 1) / pageSize) + 1) * pageSize;
+        if ((currentEnd >= limit) or ((limit - currentEnd) < bytes))
+        {
+            throw std::bad_alloc{};
+        }
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file == -1)
+        {
+            throw std::system_error{ errno, std::system_category(), "open " + path };
+        }
+        // Private mapping over the reserved range, pages are only read from the file when they are touched
+        void* address = mmap(reinterpret_cast<void*>(currentEnd), bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, file,
+            static_cast<off_t>(offset));
+        int error = errno;
+        close(file);
+        if (address == MAP_FAILED)
+        {
+            // MAP_FIXED might have replaced part of the reservation already
+            mmap(reinterpret_cast<void*>(currentEnd), bytes, PROT_NONE, MAP_PRIVATE bitor MAP_ANONYMOUS bitor MAP_FIXED, -1, 0);
+            throw std::system_error{ error, std::system_category(), "mmap " + path };
+        }
+        currentEnd += bytes;
+    }
 }
 #endif // _WIN32
\ No newline at end of file
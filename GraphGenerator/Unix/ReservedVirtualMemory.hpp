@@ -1,7 +1,9 @@
 #ifndef UNIX_RESERVED_VIRTUAL_MEMORY_HPP
 #define UNIX_RESERVED_VIRTUAL_MEMORY_HPP
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
 
 namespace GraphGenerator::Unix
 {
@@ -19,6 +21,12 @@ namespace GraphGenerator::Unix
         ReservedVirtualMemory& operator=(ReservedVirtualMemory&&) noexcept;
         void reserve(std::size_t bytes);
         void commit(std::size_t bytes);
+        // Gives the physical pages of the committed range [address, address + bytes) back to the system.
+        // The range stays committed, its contents are undefined afterwards.
+        void discard(std::uintptr_t address, std::size_t bytes);
+        // Commits the next bytes with the contents of the file at offset, a multiple of 64 KiB.
+        // Changes stay in memory, the file is not written.
+        void mapFile(std::string const& path, std::uint64_t offset, std::size_t bytes);
     };
 }
 
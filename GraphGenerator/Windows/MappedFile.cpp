@@ -0,0 +1,81 @@
+#include "MappedFile.hpp"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <cassert>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace GraphGenerator::Windows
+{
+    MappedFile::~MappedFile()
+    {
+        if (data == nullptr)
+        {
+            return;
+        }
+        BOOL result = UnmapViewOfFile(data);
+        assert(result != FALSE);
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        data = std::exchange(other.data, data);
+        size = std::exchange(other.size, size);
+        return *this;
+    }
+
+    void MappedFile::open(std::string const& path)
+    {
+        if (data != nullptr)
+        {
+            throw std::logic_error{ "file already mapped, MappedFile cannot be reused" };
+        }
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            int error = static_cast<int>(GetLastError());
+            throw std::system_error{ error, std::system_category(), "CreateFile " + path };
+        }
+        LARGE_INTEGER fileSize = { 0 };
+        if (GetFileSizeEx(file, &fileSize) == FALSE)
+        {
+            int error = static_cast<int>(GetLastError());
+            CloseHandle(file);
+            throw std::system_error{ error, std::system_category(), "GetFileSizeEx " + path };
+        }
+        size = static_cast<std::size_t>(fileSize.QuadPart);
+        if (size == 0)
+        {
+            // CreateFileMapping does not accept empty files, an empty file is simply an empty view
+            CloseHandle(file);
+            return;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr)
+        {
+            int error = static_cast<int>(GetLastError());
+            size = 0;
+            throw std::system_error{ error, std::system_category(), "CreateFileMapping " + path };
+        }
+        void* address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        // The view keeps the mapping object alive
+        CloseHandle(mapping);
+        if (address == nullptr)
+        {
+            int error = static_cast<int>(GetLastError());
+            size = 0;
+            throw std::system_error{ error, std::system_category(), "MapViewOfFile " + path };
+        }
+        data = address;
+    }
+}
+#endif // _WIN32
@@ -0,0 +1,22 @@
+#ifndef WINDOWS_MAPPED_FILE_HPP
+#define WINDOWS_MAPPED_FILE_HPP
+#include <cstddef>
+#include <string>
+
+namespace GraphGenerator::Windows
+{
+    // Read only view of a whole file
+    struct MappedFile
+    {
+        void const* data = nullptr;
+        std::size_t size = 0;
+
+        MappedFile() = default;
+        ~MappedFile();
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&&) noexcept;
+        void open(std::string const& path);
+    };
+}
+
+#endif // WINDOWS_MAPPED_FILE_HPP
@@ -6,34 +6,79 @@
 #include "../Unix/ReservedVirtualMemory.hpp"
 using GraphGenerator::Unix::ReservedVirtualMemory;
 #endif // _WIN32
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace GraphGenerator::Windows
 {
     struct MonotonicAllocatorState
     {
         using OffsetType = std::uint32_t;
+        // A handle holds the segment in its top segmentBits and the index of the element inside the segment in the others
+        static int constexpr segmentBits = 5;
+        static int constexpr indexBits = 32 - segmentBits;
+        static std::size_t constexpr maxSegments = std::size_t{ 1 } << segmentBits;
+        // Before the first element of segment 0, so that no element has the "null" handle 0
+        static std::uintptr_t constexpr startOffset = sizeof(std::max_align_t);
 
-        ReservedVirtualMemory memory;
-        std::uintptr_t allocatorBase = 0;
+        struct Segment
+        {
+            ReservedVirtualMemory memory;
+            std::uintptr_t base = 0;
+            std::uintptr_t used = 0;  // where allocation stopped before it moved on to the next segment
+        };
+
+        // Segments are only added by the root state, under its mutex.
+        // Their addresses are published in segmentBases and segmentSizes for translate and resolve on any thread,
+        // a thread only sees handles and pointers into a segment after the segment was published to it.
+        std::vector<Segment> segments;
+        std::array<std::atomic<std::uintptr_t>, maxSegments> segmentBases = {};
+        std::array<std::atomic<std::size_t>, maxSegments> segmentSizes = {};
+        std::atomic<std::size_t> segmentCount = 0;
+        // Set by the allocator, so that every element of a segment has an index of indexBits
+        std::size_t maxSegmentBytes = std::size_t{ 1 } << indexBits;
+
+        // Allocation goes to [currentOffset, currentLimit) of segments[currentSegment]
+        std::size_t currentSegment = 0;
         std::uintptr_t currentOffset = 0;
         std::uintptr_t currentLimit = 0;
+        // Most bytes used before any reset
+        std::size_t highWaterMark = 0;
         std::size_t granularity = 16 * 1024 * 1024;
+        // Leading segments that were mapped from a file by mapSegment or copied by copySegment
+        std::size_t restoredSegments = 0;
+        // Set for the sub arenas created by MonotonicAllocator::clone(),
+        // they take chunks of granularity bytes from the parent instead of reserving memory themselves.
+        // The parent itself must not allocate while its sub arenas are in use.
+        std::shared_ptr<MonotonicAllocatorState> parent = nullptr;
+        MonotonicAllocatorState* root = this;  // the state that owns the segments
+        std::mutex mutex;  // guards taking chunks from this state
 
+        // Makes sure that bytes more can be allocated without reserving address space again, as far as the segments go.
+        // Further segments are reserved when the estimate was too small.
         void reserve(std::size_t bytes)
         {
-            if (allocatorBase != 0)
+            if (parent != nullptr)
             {
-                throw std::logic_error{ "already reserved" };
+                throw std::logic_error{ "a sub arena cannot reserve memory" };
             }
-            memory.reserve(std::max(granularity, bytes));
-            allocatorBase = memory.currentEnd;
-            // prevent "null" difference, or null handle
-            allocate<alignof(std::max_align_t)>(sizeof(std::max_align_t));
-            if ((memory.limit - allocatorBase) >= std::numeric_limits<OffsetType>::max())
+            std::size_t available = 0;
+            for (std::size_t i = currentSegment; i < segments.size(); i++)
             {
-                throw std::range_error{ "memory range too large: " + std::to_string(allocatorBase) + " -> " + std::to_string(memory.limit) };
+                available += segmentSizes[i] - (i == currentSegment ? currentOffset : 0);
+            }
+            while (available < bytes and segments.size() < maxSegments)
+            {
+                available += addSegment(bytes - available);
             }
         }
 
@@ -46,10 +91,9 @@ namespace GraphGenerator::Windows
                 // align
                 std::uintptr_t result = (currentOffset + test) / alignment * alignment;
                 currentOffset = result + bytes;
-                return reinterpret_cast<void*>(allocatorBase + result);
+                return reinterpret_cast<void*>(root->segmentBases[currentSegment].load(std::memory_order_relaxed) + result);
             }
-            memory.commit(granularity);
-            currentLimit = memory.currentEnd - allocatorBase;
+            refill(bytes + alignment);
             return allocate<alignment>(bytes);
         }
 
@@ -57,6 +101,207 @@ namespace GraphGenerator::Windows
         {
             // no-op
         }
+
+        // Forgets every allocation but keeps the segments and their committed pages,
+        // so the next user does not reserve and fault them in again.
+        // Nothing allocated from this state or its sub arenas may be used afterwards.
+        void reset()
+        {
+            if (parent != nullptr)
+            {
+                throw std::logic_error{ "a sub arena cannot be reset" };
+            }
+            highWaterMark = std::max(highWaterMark, usedBytes());
+            restoredSegments = 0;
+            if (not segments.empty())
+            {
+                enterSegment(0);
+            }
+        }
+
+        // Gives the physical pages of the committed memory after the first keepBytes back to the system,
+        // for example down to the high water mark after an unusually large model. Only the unused part is trimmed.
+        void trim(std::size_t keepBytes)
+        {
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < segments.size(); i++)
+            {
+                auto& segment = segments[i];
+                std::size_t used = i < currentSegment ? segment.used : i == currentSegment ? currentOffset : 0;
+                std::size_t keep = std::max<std::size_t>(used, keepBytes > kept ? keepBytes - kept : 0);
+                std::size_t committed = segment.memory.currentEnd - segment.base;
+                if (keep < committed)
+                {
+                    segment.memory.discard(segment.base + keep, committed - keep);
+                }
+                kept += std::min(keep, committed);
+            }
+        }
+
+        std::size_t usedBytes() const
+        {
+            std::size_t result = 0;
+            for (std::size_t i = 0; i < currentSegment and i < segments.size(); i++)
+            {
+                result += segments[i].used;
+            }
+            return result + currentOffset;
+        }
+
+        std::size_t committedBytes() const
+        {
+            std::size_t result = 0;
+            for (auto& segment : segments)
+            {
+                result += segment.memory.currentEnd - segment.base;
+            }
+            return result;
+        }
+
+        // The allocated part of every segment up to the current one, segment 0 including the bytes before startOffset
+        std::vector<std::span<std::byte const>> usedSpans() const
+        {
+            std::vector<std::span<std::byte const>> result;
+            for (std::size_t i = 0; i <= currentSegment and i < segments.size(); i++)
+            {
+                std::size_t used = i < currentSegment ? segments[i].used : currentOffset;
+                result.emplace_back(reinterpret_cast<std::byte const*>(segments[i].base), used);
+            }
+            return result;
+        }
+
+        // Adds a segment with the bytes of the file at offset, as the segment after the ones restored before,
+        // so the spans of usedSpans() get their old handles back. Allocation continues behind the last restored byte.
+        // Only for a state that holds nothing but restored segments. Throws std::runtime_error if the segment does not fit.
+        void mapSegment(std::string const& path, std::uint64_t offset, std::size_t bytes)
+        {
+            Segment& segment = restoreSegment(bytes);
+            if (bytes > 0)
+            {
+                segment.memory.mapFile(path, offset, bytes);
+            }
+            enterRestoredSegment();
+        }
+
+        // Same as mapSegment, with a copy of bytes, e.g. a span of usedSpans() of another state
+        void copySegment(std::span<std::byte const> bytes)
+        {
+            Segment& segment = restoreSegment(bytes.size());
+            if (not bytes.empty())
+            {
+                segment.memory.commit(bytes.size());
+                std::memcpy(reinterpret_cast<void*>(segment.base), bytes.data(), bytes.size());
+            }
+            enterRestoredSegment();
+        }
+
+    private:
+        // Reserves a segment of at least bytes and twice the previous one, up to maxSegmentBytes.
+        // Returns its size.
+        std::size_t addSegment(std::size_t bytes)
+        {
+            if (segments.size() == maxSegments)
+            {
+                throw std::bad_alloc{};
+            }
+            if (segments.empty())
+            {
+                segments.reserve(maxSegments);
+            }
+            std::size_t size = std::max({ bytes, granularity, segments.empty() ? 0 : 2 * segmentSizes[segments.size() - 1] });
+            size = std::min(size, maxSegmentBytes);
+            auto& segment = segments.emplace_back();
+            segment.memory.reserve(size);
+            segment.base = segment.memory.currentEnd;
+            size = std::min(segment.memory.limit - segment.base, maxSegmentBytes);
+            std::size_t index = segments.size() - 1;
+            segmentBases[index].store(segment.base, std::memory_order_release);
+            segmentSizes[index].store(size, std::memory_order_release);
+            segmentCount.store(index + 1, std::memory_order_release);
+            if (index == 0)
+            {
+                enterSegment(0);
+            }
+            return size;
+        }
+
+        Segment& restoreSegment(std::size_t bytes)
+        {
+            if (parent != nullptr or restoredSegments != segments.size())
+            {
+                throw std::logic_error{ "segments can only be restored into an empty arena" };
+            }
+            if (bytes > maxSegmentBytes or segments.size() == maxSegments)
+            {
+                throw std::runtime_error{ "restored segment does not fit into the arena" };
+            }
+            addSegment(bytes);
+            segments.back().used = bytes;
+            return segments.back();
+        }
+
+        void enterRestoredSegment()
+        {
+            std::size_t index = restoredSegments++;
+            currentSegment = index;
+            currentOffset = std::max<std::uintptr_t>(segments[index].used, index == 0 ? startOffset : 0);
+            segments[index].used = currentOffset;
+            currentLimit = std::max(committedEnd(index), currentOffset);
+        }
+
+        void enterSegment(std::size_t index)
+        {
+            currentSegment = index;
+            currentOffset = index == 0 ? startOffset : 0;
+            currentLimit = std::max(committedEnd(index), currentOffset);
+        }
+
+        std::uintptr_t committedEnd(std::size_t index) const
+        {
+            return std::min<std::uintptr_t>(segments[index].memory.currentEnd - segments[index].base, segmentSizes[index]);
+        }
+
+        // Makes room for bytes at currentOffset: commits more of the current segment,
+        // or moves on to the next one, which is reserved if there is none
+        void refill(std::size_t bytes)
+        {
+            if (parent != nullptr)
+            {
+                std::size_t chunk = std::max(granularity, bytes);
+                auto const lock = std::scoped_lock{ parent->mutex };
+                auto address = reinterpret_cast<std::uintptr_t>(parent->allocate<alignof(std::max_align_t)>(chunk));
+                currentSegment = parent->currentSegment;
+                currentOffset = address - root->segmentBases[currentSegment].load(std::memory_order_relaxed);
+                currentLimit = currentOffset + chunk;
+                return;
+            }
+            if (bytes > maxSegmentBytes)
+            {
+                throw std::bad_alloc{};
+            }
+            if (currentSegment < segments.size())
+            {
+                auto& segment = segments[currentSegment];
+                std::size_t committed = segment.memory.currentEnd - segment.base;
+                std::size_t missing = currentOffset + bytes - std::min(committed, currentOffset + bytes);
+                std::size_t uncommitted = segmentSizes[currentSegment] - std::min<std::size_t>(committed, segmentSizes[currentSegment]);
+                if (missing <= uncommitted)
+                {
+                    segment.memory.commit(std::min(std::max(granularity, missing), uncommitted));
+                    currentLimit = std::max(committedEnd(currentSegment), currentOffset);
+                    return;
+                }
+                segment.used = currentOffset;
+                if (currentSegment + 1 < segments.size())
+                {
+                    enterSegment(currentSegment + 1);
+                    return;
+                }
+                currentSegment++;
+            }
+            addSegment(bytes);
+            enterSegment(segments.size() - 1);
+        }
     };
 
     template<typename T>
@@ -70,29 +315,37 @@ namespace GraphGenerator::Windows
         {
             FreeNode* next;
         };
-        std::uintptr_t allocatorBase = 0;
         FreeNode* nextFree = nullptr;
         std::shared_ptr<MonotonicAllocatorState> state = std::make_shared<MonotonicAllocatorState>();
+        MonotonicAllocatorState* root = state.get();  // owns the segments that handles refer to
 
-        MonotonicAllocator() noexcept {}
-        MonotonicAllocator(std::size_t n)
+        MonotonicAllocator() noexcept
         {
-            if (n >= std::numeric_limits<handle>::max())
-            {
-                throw std::range_error{ "too large" };
-            }
-            state->reserve(n * sizeof(StorageType));
-            allocatorBase = state->allocatorBase;
+            state->maxSegmentBytes = maxSegmentBytes();
+        }
+        // Reserves room for n elements up front, more segments are reserved once they are used up
+        MonotonicAllocator(std::size_t n) :
+            MonotonicAllocator{}
+        {
+            reserve(n);
+        }
+        // Allocates from a state that outlives the allocator, e.g. an arena that is reset between graphs
+        explicit MonotonicAllocator(std::shared_ptr<MonotonicAllocatorState> arena) noexcept :
+            state{ std::move(arena) },
+            root{ state->root }
+        {
+            state->maxSegmentBytes = std::min(state->maxSegmentBytes, maxSegmentBytes());
         }
         template<typename U>
         MonotonicAllocator(MonotonicAllocator<U> const& other) noexcept :
-            allocatorBase{ other.allocatorBase },
-            state{ other.state }
+            state{ other.state },
+            root{ other.root }
         {}
+        MonotonicAllocator(MonotonicAllocator const&) = default;
         MonotonicAllocator& operator=(MonotonicAllocator const& other) noexcept
         {
-            allocatorBase = other.allocatorBase;
             state = other.state;
+            root = other.root;
             return *this;
         }
 
@@ -105,11 +358,41 @@ namespace GraphGenerator::Windows
             return not (a == b);
         }
 
+        // Returns an allocator for another thread.
+        // It allocates from its own chunks of the same reservation, so handles stay valid across all clones.
         template<typename U>
         MonotonicAllocator<U> clone() const
         {
-            std::uintptr_t base = reinterpret_cast<std::uintptr_t>(state->memory.base);
-             return { (state->memory.limit - base) / sizeof(value_type) };
+            MonotonicAllocator<U> result;
+            result.root = root;
+            result.state->root = root;
+            result.state->granularity = 256 * 1024;
+            result.state->parent = state;
+            return result;
+        }
+
+        std::vector<std::span<std::byte const>> usedSpans() const
+        {
+            return root->usedSpans();
+        }
+
+        // See MonotonicAllocatorState::mapSegment, handles of the mapped elements are the ones they had before
+        void mapSegment(std::string const& path, std::uint64_t offset, std::size_t bytes)
+        {
+            state->mapSegment(path, offset, bytes);
+        }
+
+        // See MonotonicAllocatorState::copySegment
+        void copySegment(std::span<std::byte const> bytes)
+        {
+            state->copySegment(bytes);
+        }
+
+        // Makes sure that n more elements can be allocated without reserving address space,
+        // e.g. for an estimate of the size of a structure that is about to be built
+        void reserve(std::size_t n)
+        {
+            state->reserve(n * sizeof(StorageType));
         }
 
         T* allocate(std::size_t n)
@@ -147,8 +430,17 @@ namespace GraphGenerator::Windows
         {
             if (p != nullptr)
             {
-                std::uintptr_t offset = reinterpret_cast<std::uintptr_t>(p) - allocatorBase;
-                return static_cast<handle>(offset / sizeof(StorageType));
+                auto address = reinterpret_cast<std::uintptr_t>(p);
+                // The later segments are the larger ones
+                for (std::size_t segment = root->segmentCount.load(std::memory_order_acquire); segment-- > 0;)
+                {
+                    // Wraps around for an address below the segment
+                    std::uintptr_t offset = address - root->segmentBases[segment].load(std::memory_order_relaxed);
+                    if (offset < root->segmentSizes[segment].load(std::memory_order_relaxed))
+                    {
+                        return static_cast<handle>((segment << MonotonicAllocatorState::indexBits) bitor (offset / sizeof(StorageType)));
+                    }
+                }
             }
             return {};
         }
@@ -157,11 +449,20 @@ namespace GraphGenerator::Windows
         {
             if (h != handle{})
             {
-                std::uintptr_t offset = static_cast<std::size_t>(h) * sizeof(StorageType);
-                return reinterpret_cast<T*>(allocatorBase + offset);
+                std::size_t segment = h >> MonotonicAllocatorState::indexBits;
+                std::uintptr_t offset = static_cast<std::size_t>(h bitand indexMask) * sizeof(StorageType);
+                return reinterpret_cast<T*>(root->segmentBases[segment].load(std::memory_order_relaxed) + offset);
             }
             return nullptr;
         }
+
+    private:
+        static handle constexpr indexMask = (handle{ 1 } << MonotonicAllocatorState::indexBits) - 1;
+
+        static std::size_t constexpr maxSegmentBytes()
+        {
+            return (std::size_t{ 1 } << MonotonicAllocatorState::indexBits) * sizeof(StorageType);
+        }
     };
 }
 #endif // WINDOWS_MONOTONIC_ALLOCATOR_HPP
\ No newline at end of file
@@ -2,7 +2,9 @@
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#include <algorithm>
 #include <cassert>
+#include <fstream>
 #include <stdexcept>
 #include <system_error>
 
@@ -72,5 +74,37 @@ namespace GraphGenerator::Windows
         }
         currentEnd += bytes;
     }
+
+    void ReservedVirtualMemory::discard(std::uintptr_t address, std::size_t bytes)
+    {
+        // whole pages inside the range only
+        std::uintptr_t begin = ((address + pageSize - 1) / pageSize) * pageSize;
+        std::uintptr_t end = (std::min)(address + bytes, currentEnd) / pageSize * pageSize;
+        if (begin >= end)
+        {
+            return;
+        }
+        void* pointer = reinterpret_cast<void*>(begin);
+        if (VirtualAlloc(pointer, end - begin, MEM_RESET, PAGE_READWRITE) != pointer)
+        {
+            int error = static_cast<int>(GetLastError());
+            throw std::system_error{ error, std::system_category(), "VirtualAlloc reset" };
+        }
+    }
+
+    void ReservedVirtualMemory::mapFile(std::string const& path, std::uint64_t offset, std::size_t bytes)
+    {
+        // A view of a file cannot be placed into reserved memory without placeholders (Windows 10 1803+),
+        // so the range is committed and read instead
+        auto begin = currentEnd;
+        commit(bytes);
+        auto file = std::ifstream(path, std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(reinterpret_cast<char*>(begin), static_cast<std::streamsize>(bytes));
+        if (not file)
+        {
+            throw std::runtime_error{ "cannot read " + path };
+        }
+    }
 }
 #endif // _WIN32
\ No newline at end of file
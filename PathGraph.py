@@ -0,0 +1,94 @@
+import csv
+import ctypes
+import os
+import struct
+import sys
+
+import numpy as np
+
+# Binary PATHGRAPH written by `GraphGenerator -g` (see GraphGenerator/PathGraphFile.hpp):
+# 64 byte header, then float32[V][3] vertices and int32[E][2] edges, both 64 byte aligned, little endian.
+PATHGRAPH_MAGIC = b'PATHGRAPH\0\0\0'
+PATHGRAPH_VERSION = 1
+PATHGRAPH_HEADER = struct.Struct('<12sIQQQQQQ')
+
+
+def path_from_buffer(buffer, offset=0):
+    '''Returns (verts, edges) numpy views into buffer, nothing is copied.'''
+    magic, version, num_vert, num_edge, vert_offset, edge_offset, size, _ = PATHGRAPH_HEADER.unpack_from(buffer, offset)
+    if magic != PATHGRAPH_MAGIC:
+        raise ValueError('Not a binary PATHGRAPH')
+    if version != PATHGRAPH_VERSION:
+        raise ValueError(f'Unsupported PATHGRAPH version {version}')
+    verts = np.frombuffer(buffer, dtype='<f4', count=num_vert * 3, offset=offset + vert_offset).reshape(num_vert, 3)
+    edges = np.frombuffer(buffer, dtype='<i4', count=num_edge * 2, offset=offset + edge_offset).reshape(num_edge, 2)
+    return verts, edges
+
+
+def load_path_binary(file_path):
+    '''Memory maps a binary PATHGRAPH file, use torch.from_numpy on the results for zero copy tensors.'''
+    return path_from_buffer(np.memmap(file_path, dtype=np.uint8, mode='r'))
+
+
+class ShardedPathDataset:
+    '''Random access to a dataset baked with `GraphGenerator --batch ... -s <MiB>`.
+
+    index.csv maps object_id to (shard, offset, size), every shard is memory mapped once.
+    '''
+
+    def __init__(self, directory):
+        self.directory = directory
+        with open(os.path.join(directory, 'index.csv'), newline='') as file:
+            self.records = list(csv.DictReader(file))
+        self.lookup = {record['object_id']: i for i, record in enumerate(self.records)}
+        shard_count = max((int(record['shard']) for record in self.records), default=-1) + 1
+        self.shards = [np.memmap(os.path.join(directory, f'pathgraph-{i:05d}.shard'), dtype=np.uint8, mode='r')
+                       for i in range(shard_count)]
+
+    def __len__(self):
+        return len(self.records)
+
+    def __getitem__(self, key):
+        '''key is either an object_id or a position in the index, returns (verts, edges).'''
+        record = self.records[self.lookup[key] if isinstance(key, str) else key]
+        return path_from_buffer(self.shards[int(record['shard'])], int(record['offset']))
+
+
+class _GraphBuffer(ctypes.Structure):
+    _fields_ = [('vertices', ctypes.POINTER(ctypes.c_float)), ('edges', ctypes.POINTER(ctypes.c_int32)),
+                ('vertex_count', ctypes.c_int64), ('edge_count', ctypes.c_int64)]
+
+
+class GraphGeneratorLibrary:
+    '''In process access to GraphGeneratorLibrary (see GraphGenerator/GraphGeneratorApi.h) through ctypes.'''
+
+    def __init__(self, library_path=None):
+        if library_path is None:
+            # Either set GRAPH_GENERATOR_LIBRARY or put the library on the loader search path
+            library_path = os.environ.get('GRAPH_GENERATOR_LIBRARY') or (
+                'GraphGeneratorLibrary.dll' if sys.platform == 'win32' else
+                'libGraphGeneratorLibrary.dylib' if sys.platform == 'darwin' else 'libGraphGeneratorLibrary.so')
+        self.library = ctypes.CDLL(library_path)
+        self.library.ggGetLastError.restype = ctypes.c_char_p
+        self.library.ggBakeMesh.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.c_void_p, ctypes.c_int64,
+                                            ctypes.c_int, ctypes.c_int, ctypes.POINTER(_GraphBuffer)]
+        self.library.ggFreeGraphBuffer.argtypes = [ctypes.POINTER(_GraphBuffer)]
+
+    def bake_mesh(self, vertices, faces, layer, rotate=False):
+        '''Same result as `GraphGenerator <off> <layer> [-r]`, without files or a subprocess.
+
+        vertices is (V, 3) float, faces is (F, 3) int, returns (verts, edges) numpy arrays owned by Python.
+        '''
+        vertices = np.ascontiguousarray(vertices, dtype=np.float32)
+        faces = np.ascontiguousarray(faces, dtype=np.int32)
+        result = _GraphBuffer()
+        status = self.library.ggBakeMesh(vertices.ctypes.data, len(vertices), faces.ctypes.data, len(faces),
+                                         layer, int(rotate), ctypes.byref(result))
+        if status != 0:
+            raise RuntimeError(self.library.ggGetLastError().decode())
+        try:
+            verts = np.ctypeslib.as_array(result.vertices, shape=(result.vertex_count, 3)).copy()
+            edges = np.ctypeslib.as_array(result.edges, shape=(result.edge_count, 2)).copy()
+        finally:
+            self.library.ggFreeGraphBuffer(ctypes.byref(result))
+        return verts, edges